@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// per-hop latency of output/analyzer in the default blocking mode against
+// the low-latency mode (--pin + --spin). lines are fed at a steady pace,
+// so every worker goes idle between lines: that is where waking a sleeping
+// worker costs the most. both runs use --latency and the table lines up
+// their queue / transform / end-to-end percentiles stage by stage.
+// run from the repo root: the analyzer loads output/<name>.so from there.
+
+#define HB_MAX_ROWS  64
+#define HB_MAX_ARGS  64
+
+typedef struct {
+    char stage[64];
+    char hop[16];
+    double p50_us;
+    double p99_us;
+} row_t;
+
+typedef struct {
+    row_t rows[HB_MAX_ROWS];
+    int n;
+} report_t;
+
+static void sleep_us(long us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+// keep the [latency] rows of the analyzer's stderr
+static void parse_report(FILE* f, report_t* r) {
+    char line[512];
+    r->n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        row_t row;
+        unsigned long long count;
+        double mean, p999;
+        if (strncmp(line, "[latency] ", 10) != 0 || r->n == HB_MAX_ROWS) continue;
+        if (sscanf(line + 10, "%63s %15s %llu %lf %lf %lf %lf", row.stage, row.hop,
+                   &count, &mean, &row.p50_us, &row.p99_us, &p999) == 7) {
+            r->rows[r->n++] = row;
+        }
+    }
+}
+
+// one analyzer run fed lines at interval_us; 0 on success
+static int run(const char* analyzer, const char* opts, const char* chain, int queue_size,
+               int lines, long interval_us, report_t* out) {
+    char words[1024];
+    char* argv[HB_MAX_ARGS];
+    int argc = 0;
+    argv[argc++] = (char*)analyzer;
+    argv[argc++] = "--latency";
+    snprintf(words, sizeof(words), "%s %d %s", opts, queue_size, chain);
+    char* save = NULL;
+    for (char* w = strtok_r(words, " ", &save); w && argc < HB_MAX_ARGS - 1; w = strtok_r(NULL, " ", &save)) {
+        argv[argc++] = w;
+    }
+    argv[argc] = NULL;
+
+    int in[2], err[2];
+    if (pipe(in) != 0 || pipe(err) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(in[0], STDIN_FILENO);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+        close(in[1]);
+        close(err[0]);
+        execv(analyzer, argv);
+        _exit(127);
+    }
+    close(in[0]);
+    close(err[1]);
+
+    // one line per write, so each reaches the reader on its own
+    char line[64];
+    for (int i = 0; i < lines; ++i) {
+        int len = snprintf(line, sizeof(line), "hop bench line %d\n", i);
+        if (write(in[1], line, (size_t)len) != len) break;
+        sleep_us(interval_us);
+    }
+    if (write(in[1], "<END>\n", 6) != 6) {}
+    close(in[1]);
+
+    FILE* f = fdopen(err[0], "r");
+    if (f) {
+        parse_report(f, out);
+        fclose(f);
+    } else {
+        close(err[0]);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && out->n > 0 ? 0 : -1;
+}
+
+static const row_t* find_row(const report_t* r, const row_t* like) {
+    for (int i = 0; i < r->n; ++i) {
+        if (strcmp(r->rows[i].stage, like->stage) == 0 && strcmp(r->rows[i].hop, like->hop) == 0) {
+            return &r->rows[i];
+        }
+    }
+    return NULL;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: ./bench/hop_bench [options]\n"
+            "  --analyzer PATH    binary to run (default output/analyzer)\n"
+            "  --chain \"...\"      stages to run (default \"uppercaser rotator flipper logger\")\n"
+            "  --queue N          queue size (default 16)\n"
+            "  --lines N          lines fed (default 2000)\n"
+            "  --interval-us N    pause between lines (default 200)\n"
+            "  --pin CPUS         cpus for the low-latency run (default one per thread,\n"
+            "                     from cpu 0 up, wrapping around)\n"
+            "  --spin US          busy-poll budget of the low-latency run (default 100)\n");
+}
+
+int main(int argc, char** argv) {
+    const char* analyzer = "output/analyzer";
+    const char* chain = "uppercaser rotator flipper logger";
+    const char* pin = NULL;
+    int queue_size = 16;
+    int lines = 2000;
+    long interval_us = 200;
+    int spin_us = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[++i] : NULL;
+        if (!v) {
+            usage();
+            return 1;
+        } else if (strcmp(a, "--analyzer") == 0) {
+            analyzer = v;
+        } else if (strcmp(a, "--chain") == 0) {
+            chain = v;
+        } else if (strcmp(a, "--pin") == 0) {
+            pin = v;
+        } else if (strcmp(a, "--queue") == 0 && atoi(v) > 0) {
+            queue_size = atoi(v);
+        } else if (strcmp(a, "--lines") == 0 && atoi(v) > 0) {
+            lines = atoi(v);
+        } else if (strcmp(a, "--interval-us") == 0 && atol(v) >= 0) {
+            interval_us = atol(v);
+        } else if (strcmp(a, "--spin") == 0 && atoi(v) > 0) {
+            spin_us = atoi(v);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (access(analyzer, X_OK) != 0) {
+        fprintf(stderr, "[ERROR][bench] cannot run '%s' (build first, run from the repo root)\n", analyzer);
+        return 1;
+    }
+
+    // the reader plus one worker per stage (name:N takes N)
+    char pin_list[512];
+    if (!pin) {
+        int threads = 1;
+        const char* p = chain;
+        while (*p) {
+            while (*p == ' ') p++;
+            if (!*p) break;
+            const char* end = strchr(p, ' ');
+            if (!end) end = p + strlen(p);
+            const char* colon = memchr(p, ':', (size_t)(end - p));
+            threads += colon ? atoi(colon + 1) : 1;
+            p = end;
+        }
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus < 1) cpus = 1;
+        size_t len = 0;
+        for (int t = 0; t < threads && len < sizeof(pin_list) - 8; ++t) {
+            len += (size_t)snprintf(pin_list + len, sizeof(pin_list) - len, "%s%ld", t ? "," : "", t % cpus);
+        }
+        if (threads > cpus) {
+            fprintf(stderr, "[bench] %d threads on %ld cpus: pinned threads share cores, "
+                            "spinning will hurt\n", threads, cpus);
+        }
+        pin = pin_list;
+    }
+    char lowlat[600];
+    snprintf(lowlat, sizeof(lowlat), "--pin %s --spin %d", pin, spin_us);
+
+    static report_t base, fast;
+    fprintf(stderr, "[bench] blocking: %d lines every %ld us\n", lines, interval_us);
+    if (run(analyzer, "", chain, queue_size, lines, interval_us, &base) != 0) {
+        fprintf(stderr, "[ERROR][bench] blocking run failed\n");
+        return 1;
+    }
+    fprintf(stderr, "[bench] low-latency: %s\n", lowlat);
+    if (run(analyzer, lowlat, chain, queue_size, lines, interval_us, &fast) != 0) {
+        fprintf(stderr, "[ERROR][bench] low-latency run failed\n");
+        return 1;
+    }
+
+    printf("chain: %s, queue %d, %d lines every %ld us; low-latency: %s\n",
+           chain, queue_size, lines, interval_us, lowlat);
+    printf("%-16s %-10s %12s %12s %12s %12s\n", "stage", "hop",
+           "block p50", "block p99", "lowlat p50", "lowlat p99");
+    for (int i = 0; i < base.n; ++i) {
+        const row_t* b = &base.rows[i];
+        const row_t* f = find_row(&fast, b);
+        if (!f) continue;
+        printf("%-16s %-10s %12.1f %12.1f %12.1f %12.1f\n", b->stage, b->hop,
+               b->p50_us, b->p99_us, f->p50_us, f->p99_us);
+    }
+    return 0;
+}
+
+//gcc -O2 bench/hop_bench.c -o bench/hop_bench
+//./bench/hop_bench
+//./bench/hop_bench --chain "uppercaser flipper logger" --pin 2-5 --spin 50
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// end-to-end runs of output/analyzer over generated inputs: every input
+// profile x chain x queue size, each run a few times. prints one json
+// document to stdout (progress goes to stderr), so two runs can be saved
+// and compared before and after a change to the queue, allocator or plugins.
+// run from the repo root: the analyzer loads output/<name>.so from there.
+
+#define BENCH_MAX_ITEMS 16        // most chains / queue sizes / profiles per run
+#define BENCH_MAX_ARGS  64        // most words in one analyzer command line
+#define BENCH_RECENT    256       // lines a repeated line may be copied from
+
+// how the lines of one input file look
+typedef struct {
+    const char* name;
+    size_t lines;
+    size_t min_len;               // most lines are min_len..max_len bytes,
+    size_t max_len;               // uniformly
+    double long_rate;             // share of lines drawn from long_len instead
+    size_t long_len;
+    double repeat_rate;           // share of lines that repeat a recent one
+} profile_t;
+
+static const profile_t k_profiles[] = {
+    { "short",  1000000,   8,   64, 0.0,     0, 0.0 },
+    { "mixed",   500000,  20,  120, 0.01, 4096, 0.3 },
+    { "repeat",  500000,  20,  120, 0.0,     0, 0.9 },
+    { "long",     50000, 1024, 8192, 0.0,    0, 0.0 },
+};
+
+static const char* k_chains[] = {
+    "logger",
+    "uppercaser logger",
+    "uppercaser rotator flipper expander logger",
+    "--fuse uppercaser rotator flipper expander logger",
+    "uppercaser:4 flipper:4 logger",
+};
+
+static const int k_queue_sizes[] = { 1, 16, 256 };
+
+// one measured configuration
+typedef struct {
+    double wall_s;                // best of the repetitions
+    double median_s;
+    long   max_rss_kb;            // peak over the repetitions
+    int    status;                // exit status of the last failing run, else 0
+} result_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long next_rand(unsigned long long* s) {
+    *s = *s * 6364136223846793005ull + 1442695040888963407ull;
+    return *s >> 33;
+}
+
+static double next_unit(unsigned long long* s) {
+    return (double)next_rand(s) / (double)(1ull << 31);
+}
+
+// write the profile's lines to path; returns the byte count, 0 on failure.
+// the same seed always gives the same file
+static size_t write_input(const profile_t* p, const char* path) {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 .,:;-_[]{}@";
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+
+    size_t max_line = p->long_len > p->max_len ? p->long_len : p->max_len;
+    char* line = malloc(max_line + 1);
+    char** recent = calloc(BENCH_RECENT, sizeof(char*));
+    size_t* recent_len = calloc(BENCH_RECENT, sizeof(size_t));
+    if (!line || !recent || !recent_len) {
+        fclose(f);
+        free(line);
+        free(recent);
+        free(recent_len);
+        return 0;
+    }
+
+    unsigned long long seed = 42;
+    size_t total = 0;
+    size_t made = 0;
+    for (size_t i = 0; i < p->lines; ++i) {
+        if (made > 0 && next_unit(&seed) < p->repeat_rate) {
+            size_t k = next_rand(&seed) % (made < BENCH_RECENT ? made : BENCH_RECENT);
+            fwrite(recent[k], 1, recent_len[k], f);
+            total += recent_len[k] + 1;
+            fputc('\n', f);
+            continue;
+        }
+        size_t len = p->min_len + next_rand(&seed) % (p->max_len - p->min_len + 1);
+        if (p->long_rate > 0 && next_unit(&seed) < p->long_rate) len = p->long_len;
+        for (size_t k = 0; k < len; ++k) {
+            line[k] = alphabet[next_rand(&seed) % (sizeof(alphabet) - 1)];
+        }
+        fwrite(line, 1, len, f);
+        fputc('\n', f);
+        total += len + 1;
+
+        size_t slot = made++ % BENCH_RECENT;
+        free(recent[slot]);
+        recent[slot] = malloc(len);
+        recent_len[slot] = recent[slot] ? len : 0;
+        if (recent[slot]) memcpy(recent[slot], line, len);
+    }
+    fputs("<END>\n", f);
+
+    for (size_t k = 0; k < BENCH_RECENT; ++k) free(recent[k]);
+    free(recent);
+    free(recent_len);
+    free(line);
+    return fclose(f) == 0 ? total : 0;
+}
+
+// run the analyzer once with the input on stdin (or as --input) and output
+// discarded; wall time in *wall, peak rss of the child in *rss_kb
+static int run_once(const char* analyzer, const char* chain, int queue_size,
+                    const char* input, int use_mmap, double* wall, long* rss_kb) {
+    char words[512];
+    char qs[16];
+    char* argv[BENCH_MAX_ARGS];
+    int argc = 0;
+    argv[argc++] = (char*)analyzer;
+    if (use_mmap) {
+        argv[argc++] = "--input";
+        argv[argc++] = (char*)input;
+    }
+    // options at the front of the chain string go before the queue size
+    snprintf(words, sizeof(words), "%s", chain);
+    char* save = NULL;
+    char* w = strtok_r(words, " ", &save);
+    while (w && strncmp(w, "--", 2) == 0 && argc < BENCH_MAX_ARGS - 3) {
+        argv[argc++] = w;
+        w = strtok_r(NULL, " ", &save);
+    }
+    snprintf(qs, sizeof(qs), "%d", queue_size);
+    argv[argc++] = qs;
+    for (; w && argc < BENCH_MAX_ARGS - 1; w = strtok_r(NULL, " ", &save)) argv[argc++] = w;
+    argv[argc] = NULL;
+
+    double t0 = now_sec();
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int in = use_mmap ? open("/dev/null", O_RDONLY) : open(input, O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0) _exit(127);
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        dup2(out, STDERR_FILENO);
+        execv(analyzer, argv);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    *wall = now_sec() - t0;
+    *rss_kb = ru.ru_maxrss;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static result_t measure(const char* analyzer, const char* chain, int queue_size,
+                        const char* input, int use_mmap, int reps) {
+    result_t r = { 0, 0, 0, 0 };
+    double times[32];
+    if (reps > 32) reps = 32;
+    for (int i = 0; i < reps; ++i) {
+        long rss = 0;
+        int rc = run_once(analyzer, chain, queue_size, input, use_mmap, &times[i], &rss);
+        if (rc != 0) r.status = rc;
+        if (rss > r.max_rss_kb) r.max_rss_kb = rss;
+    }
+    qsort(times, (size_t)reps, sizeof(double), cmp_double);
+    r.wall_s = times[0];
+    r.median_s = times[reps / 2];
+    return r;
+}
+
+// json string body: the chains are plain words, only quotes need care
+static void json_str(const char* s) {
+    putchar('"');
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: ./bench/pipeline_bench [options]\n"
+            "  --analyzer PATH   binary to run (default output/analyzer)\n"
+            "  --chain \"...\"     chain to run, options first; repeatable\n"
+            "  --queue N         queue size; repeatable\n"
+            "  --profile NAME    short, mixed, repeat or long; repeatable\n"
+            "  --lines N         override the line count of every profile\n"
+            "  --reps N          runs per configuration (default 3)\n"
+            "  --mmap            pass the input as --input instead of on stdin\n");
+}
+
+int main(int argc, char** argv) {
+    const char* analyzer = "output/analyzer";
+    const char* chains[BENCH_MAX_ITEMS];
+    int queues[BENCH_MAX_ITEMS];
+    const profile_t* profiles[BENCH_MAX_ITEMS];
+    int n_chains = 0, n_queues = 0, n_profiles = 0;
+    size_t lines_override = 0;
+    int reps = 3;
+    int use_mmap = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--mmap") == 0) {
+            use_mmap = 1;
+            continue;
+        }
+        if (!v) {
+            usage();
+            return 1;
+        }
+        ++i;
+        if (strcmp(a, "--analyzer") == 0) {
+            analyzer = v;
+        } else if (strcmp(a, "--chain") == 0 && n_chains < BENCH_MAX_ITEMS) {
+            chains[n_chains++] = v;
+        } else if (strcmp(a, "--queue") == 0 && n_queues < BENCH_MAX_ITEMS && atoi(v) > 0) {
+            queues[n_queues++] = atoi(v);
+        } else if (strcmp(a, "--lines") == 0 && atol(v) > 0) {
+            lines_override = (size_t)atol(v);
+        } else if (strcmp(a, "--reps") == 0 && atoi(v) > 0) {
+            reps = atoi(v);
+        } else if (strcmp(a, "--profile") == 0 && n_profiles < BENCH_MAX_ITEMS) {
+            size_t k = 0;
+            while (k < sizeof(k_profiles) / sizeof(k_profiles[0]) && strcmp(k_profiles[k].name, v) != 0) k++;
+            if (k == sizeof(k_profiles) / sizeof(k_profiles[0])) {
+                fprintf(stderr, "[ERROR][bench] unknown profile '%s'\n", v);
+                return 1;
+            }
+            profiles[n_profiles++] = &k_profiles[k];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (access(analyzer, X_OK) != 0) {
+        fprintf(stderr, "[ERROR][bench] cannot run '%s' (build first, run from the repo root)\n", analyzer);
+        return 1;
+    }
+    if (n_chains == 0) {
+        for (size_t k = 0; k < sizeof(k_chains) / sizeof(k_chains[0]); ++k) chains[n_chains++] = k_chains[k];
+    }
+    if (n_queues == 0) {
+        for (size_t k = 0; k < sizeof(k_queue_sizes) / sizeof(k_queue_sizes[0]); ++k) queues[n_queues++] = k_queue_sizes[k];
+    }
+    if (n_profiles == 0) {
+        for (size_t k = 0; k < sizeof(k_profiles) / sizeof(k_profiles[0]); ++k) profiles[n_profiles++] = &k_profiles[k];
+    }
+
+    char input[] = "/tmp/pipeline_bench_XXXXXX";
+    int fd = mkstemp(input);
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR][bench] cannot create input file: %s\n", strerror(errno));
+        return 1;
+    }
+    close(fd);
+
+    printf("{\n  \"analyzer\": ");
+    json_str(analyzer);
+    printf(",\n  \"input\": \"%s\",\n  \"reps\": %d,\n  \"results\": [", use_mmap ? "mmap" : "stdin", reps);
+    int first = 1;
+    int failed = 0;
+    for (int p = 0; p < n_profiles; ++p) {
+        profile_t prof = *profiles[p];
+        if (lines_override) prof.lines = lines_override;
+        fprintf(stderr, "[bench] generating %s (%zu lines)\n", prof.name, prof.lines);
+        size_t bytes = write_input(&prof, input);
+        if (bytes == 0) {
+            fprintf(stderr, "[ERROR][bench] cannot write input file\n");
+            failed = 1;
+            break;
+        }
+        for (int c = 0; c < n_chains; ++c) {
+            for (int q = 0; q < n_queues; ++q) {
+                fprintf(stderr, "[bench] %-8s q=%-5d %s\n", prof.name, queues[q], chains[c]);
+                result_t r = measure(analyzer, chains[c], queues[q], input, use_mmap, reps);
+                if (r.status) failed = 1;
+                printf("%s\n    {\"profile\": \"%s\", \"chain\": ", first ? "" : ",", prof.name);
+                json_str(chains[c]);
+                printf(", \"queue_size\": %d, \"lines\": %zu, \"bytes\": %zu, "
+                       "\"wall_s\": %.4f, \"median_s\": %.4f, "
+                       "\"lines_per_s\": %.0f, \"mb_per_s\": %.2f, \"peak_rss_kb\": %ld, "
+                       "\"exit_status\": %d}",
+                       queues[q], prof.lines, bytes, r.wall_s, r.median_s,
+                       prof.lines / r.wall_s, bytes / r.wall_s / 1e6, r.max_rss_kb, r.status);
+                first = 0;
+                fflush(stdout);
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+    unlink(input);
+    return failed;
+}
+
+//gcc -O2 bench/pipeline_bench.c -o bench/pipeline_bench
+//./bench/pipeline_bench > before.json
+//./bench/pipeline_bench --profile short --queue 16 --chain "uppercaser logger" --reps 5
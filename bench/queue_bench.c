@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../plugins/sync/consumer_producer.h"
+#include "../plugins/sync/lat_hist.h"
+#include "../plugins/sync/msg_pool.h"
+
+// consumer_producer_t on its own: producers put messages stamped with the
+// time of the put, consumers take them and record how long each handoff
+// took. runs every backend x thread layout x capacity x payload size, and
+// optionally with every thread pinned to its own cpu. one row per run:
+// handoffs per second and put->get latency percentiles.
+
+#define QB_MAX_THREADS 16
+#define QB_MAX_ITEMS   16         // most values per repeatable option
+
+// queue backends the bench knows by name
+static const struct {
+    const char* name;
+    cp_backend_t backend;
+    int spsc_only;                // takes exactly one producer and one consumer
+} k_backends[] = {
+    { "locked", CP_BACKEND_LOCKED, 0 },
+    { "spsc",   CP_BACKEND_SPSC,   1 },
+};
+#define QB_N_BACKENDS (int)(sizeof(k_backends) / sizeof(k_backends[0]))
+
+// thread layouts: producers x consumers
+static const struct {
+    const char* name;
+    int producers;
+    int consumers;
+} k_layouts[] = {
+    { "spsc", 1, 1 },
+    { "mpsc", 4, 1 },
+    { "mpmc", 4, 4 },
+};
+#define QB_N_LAYOUTS (int)(sizeof(k_layouts) / sizeof(k_layouts[0]))
+
+static const int k_capacities[] = { 1, 16, 1024, 65536 };
+static const size_t k_payloads[] = { 16, 1024 };
+
+// one run's setup, shared by its threads
+typedef struct {
+    consumer_producer_t q;
+    size_t payload;
+    long items_per_producer;
+    int pin;
+    int n_cpus;
+    pthread_barrier_t start;
+} run_t;
+
+typedef struct {
+    run_t* run;
+    int cpu;                      // pinned to this cpu when run->pin is set
+    long taken;                   // consumer: messages received
+    lat_hist_t lat;               // consumer: put -> get, ns
+} worker_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void pin_self(worker_t* w) {
+    if (!w->run->pin) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu % w->run->n_cpus, &set);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void* producer(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    run_t* r = w->run;
+    pin_self(w);
+    pthread_barrier_wait(&r->start);
+    for (long i = 0; i < r->items_per_producer; ++i) {
+        msg_t m;
+        if (msg_alloc(&m, r->payload) != 0) break;
+        memset(m.data, 'x', r->payload);
+        m.t_hop = now_ns();
+        if (consumer_producer_put_msg(&r->q, &m) != 0) {
+            msg_release(&m);
+            break;
+        }
+    }
+    msg_pool_thread_flush();
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    run_t* r = w->run;
+    pin_self(w);
+    pthread_barrier_wait(&r->start);
+    msg_t m;
+    while (consumer_producer_get_msg(&r->q, &m) == 0) {
+        lat_hist_record(&w->lat, now_ns() - m.t_hop);
+        msg_release(&m);
+        w->taken++;
+    }
+    msg_pool_thread_flush();
+    return NULL;
+}
+
+// one configuration; prints its row. returns 0 when every item arrived
+static int run_one(int backend, int layout, int capacity, size_t payload, long items, int pin) {
+    static worker_t workers[2 * QB_MAX_THREADS];
+    static lat_hist_t total;
+    int np = k_layouts[layout].producers;
+    int nc = k_layouts[layout].consumers;
+
+    run_t r;
+    if (consumer_producer_init_backend(&r.q, capacity, k_backends[backend].backend) != 0) return -1;
+    r.payload = payload;
+    r.items_per_producer = items / np;
+    r.pin = pin;
+    r.n_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (r.n_cpus < 1) r.n_cpus = 1;
+    pthread_barrier_init(&r.start, NULL, (unsigned)(np + nc + 1));
+
+    pthread_t tids[2 * QB_MAX_THREADS];
+    for (int i = 0; i < np + nc; ++i) {
+        workers[i].run = &r;
+        workers[i].cpu = i;
+        workers[i].taken = 0;
+        lat_hist_init(&workers[i].lat);
+        pthread_create(&tids[i], NULL, i < np ? producer : consumer, &workers[i]);
+    }
+
+    pthread_barrier_wait(&r.start);
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < np; ++i) pthread_join(tids[i], NULL);
+    // consumers drain what is left, then see the end
+    consumer_producer_signal_finished(&r.q);
+    for (int i = np; i < np + nc; ++i) pthread_join(tids[i], NULL);
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    long taken = 0;
+    lat_hist_init(&total);
+    for (int i = np; i < np + nc; ++i) {
+        taken += workers[i].taken;
+        lat_hist_merge(&total, &workers[i].lat);
+    }
+    printf("%-7s %-5s %3s %8d %8zu %12.0f %10.2f %10.2f %10.2f %10.2f\n",
+           k_backends[backend].name, k_layouts[layout].name, pin ? "yes" : "no",
+           capacity, payload, (double)taken / secs,
+           lat_hist_percentile(&total, 50.0) / 1e3,
+           lat_hist_percentile(&total, 99.0) / 1e3,
+           lat_hist_percentile(&total, 99.9) / 1e3,
+           lat_hist_percentile(&total, 100.0) / 1e3);
+    fflush(stdout);
+
+    pthread_barrier_destroy(&r.start);
+    consumer_producer_destroy(&r.q);
+    return taken == r.items_per_producer * np ? 0 : -1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: ./bench/queue_bench [options]\n"
+            "  --backend NAME   locked or spsc; repeatable (default all)\n"
+            "  --layout NAME    spsc (1x1), mpsc (4x1) or mpmc (4x4); repeatable\n"
+            "  --capacity N     queue capacity, 1..65536; repeatable\n"
+            "  --payload N      payload bytes per message; repeatable\n"
+            "  --items N        messages per run (default 200000)\n"
+            "  --pin            pin every thread to its own cpu\n"
+            "  --both-pin       run unpinned and pinned\n");
+}
+
+static int find_backend(const char* name) {
+    for (int k = 0; k < QB_N_BACKENDS; ++k) {
+        if (strcmp(k_backends[k].name, name) == 0) return k;
+    }
+    return -1;
+}
+
+static int find_layout(const char* name) {
+    for (int k = 0; k < QB_N_LAYOUTS; ++k) {
+        if (strcmp(k_layouts[k].name, name) == 0) return k;
+    }
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    int backends[QB_MAX_ITEMS], layouts[QB_MAX_ITEMS], capacities[QB_MAX_ITEMS];
+    size_t payloads[QB_MAX_ITEMS];
+    int n_backends = 0, n_layouts = 0, n_capacities = 0, n_payloads = 0;
+    long items = 200000;
+    int pin_from = 0, pin_to = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (strcmp(a, "--pin") == 0) {
+            pin_from = pin_to = 1;
+            continue;
+        }
+        if (strcmp(a, "--both-pin") == 0) {
+            pin_from = 0;
+            pin_to = 1;
+            continue;
+        }
+        const char* v = i + 1 < argc ? argv[++i] : NULL;
+        int idx = -1;
+        if (!v) {
+            usage();
+            return 1;
+        } else if (strcmp(a, "--backend") == 0 && n_backends < QB_MAX_ITEMS) {
+            idx = find_backend(v);
+            if (idx >= 0) backends[n_backends++] = idx;
+        } else if (strcmp(a, "--layout") == 0 && n_layouts < QB_MAX_ITEMS) {
+            idx = find_layout(v);
+            if (idx >= 0) layouts[n_layouts++] = idx;
+        } else if (strcmp(a, "--capacity") == 0 && n_capacities < QB_MAX_ITEMS) {
+            idx = atoi(v);
+            if (idx >= 1 && idx <= 65536) capacities[n_capacities++] = idx;
+            else idx = -1;
+        } else if (strcmp(a, "--payload") == 0 && n_payloads < QB_MAX_ITEMS) {
+            payloads[n_payloads++] = (size_t)atol(v);
+            idx = 0;
+        } else if (strcmp(a, "--items") == 0 && atol(v) > 0) {
+            items = atol(v);
+            idx = 0;
+        }
+        if (idx < 0) {
+            fprintf(stderr, "[ERROR][bench] bad option '%s %s'\n", a, v);
+            usage();
+            return 1;
+        }
+    }
+    if (n_backends == 0) for (int k = 0; k < QB_N_BACKENDS; ++k) backends[n_backends++] = k;
+    if (n_layouts == 0) for (int k = 0; k < QB_N_LAYOUTS; ++k) layouts[n_layouts++] = k;
+    if (n_capacities == 0) {
+        for (size_t k = 0; k < sizeof(k_capacities) / sizeof(k_capacities[0]); ++k) capacities[n_capacities++] = k_capacities[k];
+    }
+    if (n_payloads == 0) {
+        for (size_t k = 0; k < sizeof(k_payloads) / sizeof(k_payloads[0]); ++k) payloads[n_payloads++] = k_payloads[k];
+    }
+
+    // payloads come from the pool, as they do in the pipeline
+    msg_pool_t* pool = msg_pool_create();
+    msg_use_pool(pool);
+
+    printf("%-7s %-5s %3s %8s %8s %12s %10s %10s %10s %10s\n",
+           "backend", "shape", "pin", "capacity", "payload", "ops/s",
+           "p50_us", "p99_us", "p999_us", "max_us");
+    int failed = 0;
+    for (int b = 0; b < n_backends; ++b) {
+        for (int l = 0; l < n_layouts; ++l) {
+            // the ring takes one producer and one consumer only
+            if (k_backends[backends[b]].spsc_only &&
+                (k_layouts[layouts[l]].producers > 1 || k_layouts[layouts[l]].consumers > 1)) {
+                continue;
+            }
+            for (int c = 0; c < n_capacities; ++c) {
+                for (int p = 0; p < n_payloads; ++p) {
+                    for (int pin = pin_from; pin <= pin_to; ++pin) {
+                        if (run_one(backends[b], layouts[l], capacities[c], payloads[p], items, pin) != 0) {
+                            fprintf(stderr, "[ERROR][bench] items lost\n");
+                            failed = 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    msg_pool_thread_flush();
+    msg_use_pool(NULL);
+    msg_pool_destroy(pool);
+    return failed;
+}
+
+//gcc -O2 bench/queue_bench.c plugins/sync/consumer_producer.c plugins/sync/monitor.c plugins/sync/message.c plugins/sync/msg_pool.c plugins/sync/lat_hist.c -lpthread -o bench/queue_bench
+//./bench/queue_bench --both-pin
+//./bench/queue_bench --backend locked --layout mpmc --capacity 1 --capacity 1024
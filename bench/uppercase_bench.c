@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../plugins/kernels/text_kernels.h"
+
+// uppercase kernel vs the per-byte toupper() loop, across line lengths.
+// every length is also checked byte-for-byte against the reference.
+
+#define BENCH_TOTAL_BYTES (64u << 20)   // bytes converted per measurement
+
+typedef void (*upper_fn)(char*, const char*, size_t);
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// mixed-case ascii text with a sprinkle of punctuation and digits
+static void fill_text(char* buf, size_t n, unsigned seed) {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 .,:;-_[]{}@";
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+}
+
+// run fn over the line until BENCH_TOTAL_BYTES were processed; returns GB/s
+static double measure(upper_fn fn, char* dst, const char* src, size_t len) {
+    size_t reps = BENCH_TOTAL_BYTES / len + 1;
+    double t0 = now_sec();
+    for (size_t r = 0; r < reps; ++r) {
+        fn(dst, src, len);
+        // keep the compiler from hoisting the call out of the loop
+        __asm__ __volatile__("" : : "r"(dst) : "memory");
+    }
+    double dt = now_sec() - t0;
+    return (double)reps * len / dt / 1e9;
+}
+
+int main(void) {
+    static const size_t lengths[] = { 8, 16, 31, 64, 100, 256, 1024, 4096, 65536 };
+    size_t max_len = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+    char* src = malloc(max_len);
+    char* ref = malloc(max_len);
+    char* out = malloc(max_len);
+    if (!src || !ref || !out) {
+        fprintf(stderr, "[ERROR][bench] out of memory\n");
+        return 1;
+    }
+    fill_text(src, max_len, 42);
+    // a few bytes outside ascii exercise the fallback path
+    src[max_len / 2] = (char)0xE9;
+    src[max_len / 4] = (char)0xFF;
+
+    printf("%8s %12s %12s %8s\n", "len", "scalar GB/s", "kernel GB/s", "speedup");
+    for (size_t k = 0; k < sizeof(lengths) / sizeof(lengths[0]); ++k) {
+        size_t len = lengths[k];
+        const char* line = src + (max_len - len);
+
+        text_upper_scalar(ref, line, len);
+        text_upper(out, line, len);
+        if (memcmp(ref, out, len) != 0) {
+            fprintf(stderr, "[ERROR][bench] kernel output differs at len %zu\n", len);
+            return 1;
+        }
+
+        double s = measure(text_upper_scalar, out, line, len);
+        double v = measure(text_upper, out, line, len);
+        printf("%8zu %12.2f %12.2f %7.1fx\n", len, s, v, v / s);
+    }
+
+    free(src);
+    free(ref);
+    free(out);
+    return 0;
+}
+
+//gcc -O2 bench/uppercase_bench.c plugins/kernels/text_kernels.c -o bench/uppercase_bench
+//./bench/uppercase_bench
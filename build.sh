@@ -19,7 +19,7 @@ shared_link="-shared"
 
 # build analyzer
 log_status "building analyzer"
-gcc -o output/analyzer main.c $cflags -lpthread -ldl
+gcc -o output/analyzer main.c plugins/sync/message.c plugins/sync/msg_pool.c plugins/sync/lat_hist.c $cflags -lpthread -ldl
 
 # build plugins
 plugins=(logger uppercaser expander flipper rotator typewriter)
@@ -31,6 +31,10 @@ for p in "${plugins[@]}"; do
     plugins/plugin_common.c \
     plugins/sync/consumer_producer.c \
     plugins/sync/monitor.c \
+    plugins/sync/message.c \
+    plugins/sync/msg_pool.c \
+    plugins/sync/lat_hist.c \
+    plugins/kernels/text_kernels.c \
     -lpthread -ldl
 done
 
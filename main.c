@@ -1,44 +1,182 @@
 #define _GNU_SOURCE
+#include <ctype.h>
 #include <dlfcn.h>
+#include <errno.h>
 #include <link.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "plugins/plugin_sdk.h"
+#include "plugins/sync/msg_pool.h"
 
 // function pointer typedefs pf means plugin-function 
+typedef const char* (*pf_create_t)(const plugin_options_t*, void**);
+typedef const char* (*pf_fini_t)(void*);
+typedef const char* (*pf_place_msg_t)(void*, msg_t*);
+typedef const char* (*pf_place_msg_batch_t)(void*, msg_t*, int);
+typedef void        (*pf_attach_t)(void*, const plugin_sink_t*);
+typedef const char* (*pf_wait_t)(void*);
+typedef const char* (*pf_getname_t)(void);
+typedef msg_transform_fn (*pf_pure_t)(void);
+typedef void        (*pf_use_pool_t)(struct msg_pool*);
+typedef const char* (*pf_fuse_t)(void*, const msg_transform_fn*, int);
+typedef const char* (*pf_stats_t)(void*, plugin_stats_t*);
+typedef const char* (*pf_latency_t)(void*, plugin_latency_t*);
+
+// the original string SDK: one implicit instance per shared object 
 typedef const char* (*pf_init_t)(int);
-typedef const char* (*pf_fini_t)(void);
+typedef const char* (*pf_legacy_fini_t)(void);
 typedef const char* (*pf_place_t)(const char*);
-typedef void        (*pf_attach_t)(const char* (*)(const char*));
-typedef const char* (*pf_wait_t)(void);
-typedef const char* (*pf_getname_t)(void);
+typedef void        (*pf_legacy_attach_t)(pf_place_t);
+typedef const char* (*pf_legacy_wait_t)(void);
+
+// a plugin without the instance API. the host drives it through adapters
+// with the instance signatures, the instance handle pointing here 
+typedef struct {
+    pf_init_t            init;
+    pf_legacy_fini_t     fini;
+    pf_place_t           place_work;
+    pf_legacy_attach_t   attach;
+    pf_legacy_wait_t     wait_finished;
+    plugin_sink_t        next;        // where its results go, via a trampoline
+} legacy_stage_t;
 
-// plugin handle
+// a host-side sink between instances. a tee copies every result to each
+// of its branches; a merge lets several stages feed one and passes on only
+// the <END> of the last of them to end; a route sends each line to one
+// branch, picked by a hash of its key 
 typedef struct {
-    void*         handle;
-    pf_place_t    place_work;
-    pf_attach_t   attach;
-    pf_wait_t     wait_finished;
-    pf_init_t     init;
-    pf_fini_t     fini;
-    pf_getname_t  get_name;
-    const char*   id_hint;    //id for logs before init 
+    plugin_sink_t*       to;          // tee, route: one per branch; merge: the stage fed
+    int                  n;
+    atomic_int           ends_left;   // merge: inputs whose <END> is still to come
+    int                  key_field;   // route: 1-based field hashed, 0 the whole line
+    char                 key_delim;   // route: what separates fields
+} junction_t;
+
+// plugin handle: one per stage of the graph, so a plugin may repeat 
+typedef struct {
+    void*                handle;
+    void*                inst;        // instance handle from create
+    pf_create_t          create;      // NULL for a legacy plugin
+    legacy_stage_t*      legacy;      // set when it only has the string SDK
+    pf_fini_t            fini;
+    pf_place_msg_t       place_msg;
+    pf_place_msg_batch_t place_msg_batch;
+    pf_attach_t          attach;
+    pf_wait_t            wait_finished;
+    pf_getname_t         get_name;
+    const char*          id_hint;     //id for logs before init 
+    int                  workers;     // from a name:N stage spec
+    int                  overflow;    // from a name@policy stage spec, or --overflow
+    int                  overflow_ms;
+    int                  own_policy;  // the spec named its policy; never fused
+    pf_pure_t            get_pure;    // optional, used with --fuse
+    pf_fuse_t            fuse;        // optional, used with --fuse
+    pf_stats_t           stats;       // optional, used with --metrics
+    pf_latency_t         latency;     // optional, used with --latency
+    msg_transform_fn     pure;        // set when this stage may be fused
+    int                  head;        // stage whose instance runs this one
+    const int*           cpus;        // --pin: one per worker of this instance
+    int                  n_in;        // stages feeding this one; 0 reads the input
+    int                  n_out;       // stages this one feeds
+    int                  pred;        // the stage feeding it, when n_in is 1
+    int                  fused;       // head: stages fused into its instance
+    junction_t*          merge;       // n_in > 1: where its inputs meet
 } plugin_handle_t;
 
-// args for a separate stdin feeder thread 
+#define MAX_PIN_CPUS 1024             // most cpus a --pin list may name
+#define MAX_STAGES   256              // most stages one run may have
+#define MAX_LINKS    1024             // most links between them
+
+// the stages and the links between them; a plain chain is i -> i + 1.
+// once sorted, every link goes from a lower index to a higher one 
+typedef struct {
+    const char*          id[MAX_STAGES];      // stage name in logs and tables
+    const char*          spec[MAX_STAGES];    // name[:workers][@policy]
+    int                  declared[MAX_STAGES];
+    int                  n;
+    int                  from[MAX_LINKS];
+    int                  to[MAX_LINKS];
+    int                  n_links;
+    char*                text;                // --graph text the strings point into
+    junction_t*          junctions;           // tees and merges the wiring made
+    int                  n_junctions;
+    int                  partitions;          // --partitions: copies of the chain, else 0
+    int                  key_field;           // --key: the route's key
+    char                 key_delim;
+} graph_t;
+
+static graph_t g_graph;
+
+// payload pool shared by the host and every plugin; NULL means malloc 
+static msg_pool_t* g_pool;
+
+// where lines come from: a stream, or a file mapped whole 
 typedef struct {
-    pf_place_t first_stage;
+    int         fd;               // stdin, or the --input file
+    const char* map;              // mapping of a regular --input file, else NULL
+    size_t      map_len;
+} input_t;
+
+// args for a separate input feeder thread 
+typedef struct {
+    plugin_sink_t        to;          // the first stage, or a tee over every source
+    input_t              in;
+    int                  stamp;       // --latency: set each line's ingest time
 } feeder_args_t;
 
 // usage printout as required 
 static void print_usage(void) {
-    printf("Usage: ./analyzer <queue_size> <plugin1> <plugin2> ... <pluginN>\n");
+    printf("Usage: ./analyzer [options] <queue_size> <plugin1> <plugin2> ... <pluginN>\n");
+    printf("       ./analyzer [options] --graph SPEC <queue_size>\n");
+    printf("Options:\n");
+    printf("  --fuse        Run adjacent side-effect-free stages in one worker,\n");
+    printf("                without a queue between them; a stage with its own\n");
+    printf("                name@P keeps its queue and is not fused\n");
+    printf("  --input PATH  Read lines from PATH instead of stdin; a regular file\n");
+    printf("                is memory-mapped and must not change while running\n");
+    printf("  --metrics     Keep per-stage counters; print them to stderr at\n");
+    printf("                shutdown and on SIGUSR1\n");
+    printf("  --latency     Time every line from input to the end of the chain;\n");
+    printf("                print per-stage percentiles to stderr at shutdown\n");
+    printf("  --overflow P  What a full queue does with new lines, unless a stage\n");
+    printf("                sets its own with name@P: block (default), timeout:MS\n");
+    printf("                (block up to MS, then drop), drop-newest, drop-oldest;\n");
+    printf("                <END> is never dropped\n");
+    printf("  --pin CPUS    Pin the input reader, then every stage worker in chain\n");
+    printf("                order, each to the next cpu of CPUS (e.g. 2,3,4-7);\n");
+    printf("                string-SDK stages run their own threads and take none\n");
+    printf("  --spin US     Workers busy-poll an empty queue for US microseconds\n");
+    printf("                before sleeping; use with --pin on idle cores\n");
+    printf("  --partitions K  Run K copies of every stage but the last; each line\n");
+    printf("                goes to the copy its key hashes to, so lines with one\n");
+    printf("                key keep their order; the copies merge into the last\n");
+    printf("                stage, interleaved\n");
+    printf("  --key F[:C]   Key for --partitions: field F (from 1) of the line\n");
+    printf("                split at C (default ','); 0 or line, the default, is\n");
+    printf("                the whole line\n");
+    printf("  --graph SPEC  Run a graph of stages instead of a chain. SPEC, or the\n");
+    printf("                file @PATH, holds statements split by ';' or lines:\n");
+    printf("                'id = stage' names a stage, 'a -> b -> c' links stages;\n");
+    printf("                any other word is the stage of that name. A stage\n");
+    printf("                linked to several sends each a copy of its output;\n");
+    printf("                one linked from several takes their lines as they come\n");
     printf("Arguments:\n");
     printf("  queue_size    Positive integer for each plugin's queue capacity\n");
-    printf("  plugin1..N    Names of plugins to load (without .so extension)\n");
+    printf("  plugin1..N    Names of plugins to load (without .so extension);\n");
+    printf("                a plugin may appear more than once; name:N runs\n");
+    printf("                that stage on N worker threads, output stays in order;\n");
+    printf("                name@P sets the policy of that stage's input queue\n");
+    printf("                (a plugin with only plugin_init/plugin_place_work runs\n");
+    printf("                once per chain, on one worker)\n");
     printf("\n");
     printf("Common plugins (if present):\n");
     printf("  logger, typewriter, uppercaser, rotator, flipper, expander\n");
@@ -46,6 +184,335 @@ static void print_usage(void) {
     printf("  ./analyzer 20 uppercaser rotator logger\n");
     printf("  echo 'hello' | ./analyzer 20 uppercaser rotator logger\n");
     printf("  echo '<END>' | ./analyzer 20 uppercaser rotator logger\n");
+    printf("  ./analyzer 20 uppercaser:4 flipper:4 logger\n");
+    printf("  ./analyzer --fuse 20 uppercaser rotator flipper expander logger\n");
+    printf("  ./analyzer --input big.log 64 uppercaser logger\n");
+    printf("  ./analyzer 64 uppercaser@drop-oldest logger@timeout:5\n");
+    printf("  ./analyzer --pin 2-5 --spin 50 16 uppercaser flipper logger\n");
+    printf("  ./analyzer --graph 'uppercaser -> logger; uppercaser -> flipper -> out;\n");
+    printf("                      out = logger' 20\n");
+    printf("  ./analyzer --partitions 4 --key 2:' ' 64 uppercaser rotator logger\n");
+}
+
+// a cpu list such as 0,2,4-7, in order; the count, or -1 if malformed 
+static int parse_cpus(const char* spec, int* cpus, int cap) {
+    int n = 0;
+    const char* p = spec;
+    while (*p) {
+        char* end = NULL;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+        if (end == p || lo < 0) return -1;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo) return -1;
+        }
+        if (hi >= CPU_SETSIZE) return -1;
+        for (long c = lo; c <= hi; ++c) {
+            if (n == cap) return -1;
+            cpus[n++] = (int)c;
+        }
+        if (*end == ',') end++;
+        else if (*end != '\0') return -1;
+        p = end;
+    }
+    return n > 0 ? n : -1;
+}
+
+// an overflow policy: block, timeout:MS, drop-newest or drop-oldest; -1 if unknown 
+static int parse_overflow(const char* spec, int* policy, int* timeout_ms) {
+    *timeout_ms = 0;
+    if (strcmp(spec, "block") == 0) {
+        *policy = PLUGIN_OVERFLOW_BLOCK;
+    } else if (strcmp(spec, "drop-newest") == 0) {
+        *policy = PLUGIN_OVERFLOW_DROP_NEWEST;
+    } else if (strcmp(spec, "drop-oldest") == 0) {
+        *policy = PLUGIN_OVERFLOW_DROP_OLDEST;
+    } else if (strncmp(spec, "timeout:", 8) == 0) {
+        char* end = NULL;
+        long ms = strtol(spec + 8, &end, 10);
+        if (end == spec + 8 || *end != '\0' || ms < 0 || ms > 3600000) return -1;
+        *policy = PLUGIN_OVERFLOW_TIMEOUT;
+        *timeout_ms = (int)ms;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// a --key spec: 0 or "line" for the whole line, else F or F:C, field F
+// (from 1) of the line split at C; -1 if malformed 
+static int parse_key(const char* spec, int* field, char* delim) {
+    *delim = ',';
+    if (strcmp(spec, "line") == 0) {
+        *field = 0;
+        return 0;
+    }
+    char* end = NULL;
+    long f = strtol(spec, &end, 10);
+    if (end == spec || f < 0 || f > 1024) return -1;
+    if (*end == ':' && end[1] != '\0' && end[2] == '\0') {
+        *delim = end[1];
+    } else if (*end != '\0') {
+        return -1;
+    }
+    *field = (int)f;
+    return 0;
+}
+
+// a whole decimal count from 1 to max; -1 if anything else 
+static int parse_count(const char* spec, long max) {
+    char* end = NULL;
+    long v = strtol(spec, &end, 10);
+    if (end == spec || *end != '\0' || v < 1 || v > max) return -1;
+    return (int)v;
+}
+
+// split a name[:workers][@policy] stage spec; the name goes to out, -1 on
+// a bad spec. the policy fields keep their value when the spec has none 
+static int parse_stage(const char* spec, char* name, size_t cap, plugin_handle_t* p) {
+    const char* at = strchr(spec, '@');
+    size_t stage_len = at ? (size_t)(at - spec) : strlen(spec);
+    const char* colon = memchr(spec, ':', stage_len);
+    size_t len = colon ? (size_t)(colon - spec) : stage_len;
+    if (len == 0 || len >= cap) return -1;
+    memcpy(name, spec, len);
+    name[len] = '\0';
+
+    p->workers = 1;
+    if (colon) {
+        char* end = NULL;
+        long n = strtol(colon + 1, &end, 10);
+        if (end == colon + 1 || end != spec + stage_len || n <= 0 || n > 64) return -1;
+        p->workers = (int)n;
+    }
+    if (at && parse_overflow(at + 1, &p->overflow, &p->overflow_ms) != 0) return -1;
+    p->own_policy = at != NULL;
+    return 0;
+}
+
+// strip surrounding blanks in place 
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+// index of the stage called id; an unknown id is a new stage of that name 
+static int graph_stage(graph_t* g, const char* id) {
+    for (int i = 0; i < g->n; ++i) {
+        if (strcmp(g->id[i], id) == 0) return i;
+    }
+    if (g->n == MAX_STAGES) {
+        fprintf(stderr, "[ERROR] More than %d stages\n", MAX_STAGES);
+        return -1;
+    }
+    g->id[g->n] = g->spec[g->n] = id;
+    g->declared[g->n] = 0;
+    return g->n++;
+}
+
+// add the link a -> b once 
+static int graph_link(graph_t* g, int a, int b) {
+    for (int e = 0; e < g->n_links; ++e) {
+        if (g->from[e] == a && g->to[e] == b) return 0;
+    }
+    if (g->n_links == MAX_LINKS) {
+        fprintf(stderr, "[ERROR] More than %d links\n", MAX_LINKS);
+        return -1;
+    }
+    g->from[g->n_links] = a;
+    g->to[g->n_links] = b;
+    g->n_links++;
+    return 0;
+}
+
+// one statement: 'id = stage' or 'a -> b -> ...'; -1 if malformed 
+static int graph_statement(graph_t* g, char* st) {
+    char* eq = strchr(st, '=');
+    if (eq) {
+        *eq = '\0';
+        char* id = trim(st);
+        char* spec = trim(eq + 1);
+        if (!*id || !*spec || strpbrk(id, " \t:@") || strstr(spec, "->")) {
+            fprintf(stderr, "[ERROR] Invalid stage declaration '%s = %s'\n", id, spec);
+            return -1;
+        }
+        int i = graph_stage(g, id);
+        if (i < 0) return -1;
+        if (g->declared[i]) {
+            fprintf(stderr, "[ERROR] Stage '%s' declared twice\n", id);
+            return -1;
+        }
+        g->spec[i] = spec;
+        g->declared[i] = 1;
+        return 0;
+    }
+
+    int prev = -1;
+    for (char* p = st;;) {
+        char* arrow = strstr(p, "->");
+        if (arrow) *arrow = '\0';
+        char* id = trim(p);
+        if (!*id) {
+            fprintf(stderr, "[ERROR] Missing stage around '->'\n");
+            return -1;
+        }
+        int cur = graph_stage(g, id);
+        if (cur < 0 || (prev >= 0 && graph_link(g, prev, cur) != 0)) return -1;
+        prev = cur;
+        if (!arrow) return 0;
+        p = arrow + 2;
+    }
+}
+
+// the whole text of a file (or pipe); NULL on error 
+static char* read_text(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[ERROR] Cannot open graph '%s': %s\n", path, strerror(errno));
+        return NULL;
+    }
+    size_t len = 0, cap = 4096;
+    char* text = (char*)malloc(cap);
+    size_t r;
+    while (text && (r = fread(text + len, 1, cap - len - 1, f)) > 0) {
+        len += r;
+        if (len + 1 == cap) {
+            char* grown = (char*)realloc(text, cap * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+// --graph SPEC: statements split by newlines or ';', '#' comments to the
+// end of the line; @PATH reads them from PATH 
+static int graph_parse(graph_t* g, const char* spec) {
+    g->text = spec[0] == '@' ? read_text(spec + 1) : strdup(spec);
+    if (!g->text) return -1;
+
+    char* line_save = NULL;
+    for (char* line = strtok_r(g->text, "\n", &line_save); line; line = strtok_r(NULL, "\n", &line_save)) {
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* st_save = NULL;
+        for (char* st = strtok_r(line, ";", &st_save); st; st = strtok_r(NULL, ";", &st_save)) {
+            st = trim(st);
+            if (*st && graph_statement(g, st) != 0) return -1;
+        }
+    }
+    if (g->n == 0) {
+        fprintf(stderr, "[ERROR] Graph has no stages\n");
+        return -1;
+    }
+    return 0;
+}
+
+// the positional stage list as a graph: each stage feeds the next 
+static int graph_chain(graph_t* g, char** names, int n) {
+    if (n > MAX_STAGES) {
+        fprintf(stderr, "[ERROR] More than %d stages\n", MAX_STAGES);
+        return -1;
+    }
+    for (int i = 0; i < n; ++i) {
+        g->id[i] = g->spec[i] = names[i];
+        g->declared[i] = 1;
+        if (i > 0) {
+            g->from[i - 1] = i - 1;
+            g->to[i - 1] = i;
+        }
+    }
+    g->n = n;
+    g->n_links = n - 1;
+    return 0;
+}
+
+// the chain with everything but its last stage copied k times: copy p of
+// stage i is called "name#p", and every copy feeds the one last stage 
+static int graph_partition(graph_t* g, char** names, int n, int k) {
+    if (n < 2) {
+        fprintf(stderr, "[ERROR] --partitions needs a stage before the last one\n");
+        return -1;
+    }
+    // k first: (n - 1) * k must not overflow before the check 
+    if (k > (MAX_STAGES - 1) / (n - 1)) {
+        fprintf(stderr, "[ERROR] More than %d stages\n", MAX_STAGES);
+        return -1;
+    }
+    size_t room = 0;
+    for (int i = 0; i < n - 1; ++i) room += strlen(names[i]) + 8;
+    g->text = (char*)malloc(room * (size_t)k);
+    if (!g->text) return -1;
+
+    char* at = g->text;
+    for (int p = 0; p < k; ++p) {
+        for (int i = 0; i < n - 1; ++i) {
+            int s = p * (n - 1) + i;
+            g->id[s] = at;
+            g->spec[s] = names[i];
+            at += snprintf(at, room * (size_t)k - (size_t)(at - g->text),
+                           "%s#%d", names[i], p) + 1;
+            if (i > 0) graph_link(g, s - 1, s);
+        }
+    }
+    int sink = k * (n - 1);
+    g->id[sink] = g->spec[sink] = names[n - 1];
+    g->n = sink + 1;
+    for (int p = 0; p < k; ++p) graph_link(g, p * (n - 1) + n - 2, sink);
+    g->partitions = k;
+    return 0;
+}
+
+// renumber the stages in topological order, keeping the written order where
+// the links allow; -1 if they form a cycle 
+static int graph_sort(graph_t* g) {
+    int indeg[MAX_STAGES] = {0};
+    int order[MAX_STAGES];
+    int pos[MAX_STAGES];
+    int placed[MAX_STAGES] = {0};
+    for (int e = 0; e < g->n_links; ++e) indeg[g->to[e]]++;
+
+    for (int k = 0; k < g->n; ++k) {
+        int pick = -1;
+        for (int i = 0; i < g->n && pick < 0; ++i) {
+            if (!placed[i] && indeg[i] == 0) pick = i;
+        }
+        if (pick < 0) {
+            fprintf(stderr, "[ERROR] Graph has a cycle\n");
+            return -1;
+        }
+        placed[pick] = 1;
+        order[k] = pick;
+        pos[pick] = k;
+        for (int e = 0; e < g->n_links; ++e) {
+            if (g->from[e] == pick) indeg[g->to[e]]--;
+        }
+    }
+
+    const char* id[MAX_STAGES];
+    const char* spec[MAX_STAGES];
+    for (int k = 0; k < g->n; ++k) {
+        id[k] = g->id[order[k]];
+        spec[k] = g->spec[order[k]];
+    }
+    memcpy(g->id, id, sizeof(id[0]) * (size_t)g->n);
+    memcpy(g->spec, spec, sizeof(spec[0]) * (size_t)g->n);
+    for (int e = 0; e < g->n_links; ++e) {
+        g->from[e] = pos[g->from[e]];
+        g->to[e] = pos[g->to[e]];
+    }
+    return 0;
 }
 
 // resolve symbols explicitly instead of a shared macro 
@@ -60,160 +527,950 @@ static int resolve_symbol(void* handle, const char* sym, void** out) {
     return 0;
 }
 
-// trim trailing newline if present 
-static inline void strip_nl(char* s) {
-    size_t n = strlen(s);
-    if (n && s[n - 1] == '\n') s[n - 1] = '\0';
+// optional symbols: missing is not an error 
+static void* resolve_optional(void* handle, const char* sym) {
+    dlerror(); // reset 
+    void* p = dlsym(handle, sym);
+    return dlerror() ? NULL : p;
 }
 
-// thread that reads stdin and forwards to the first stage 
-static void* stdin_feeder(void* arg) {
-    feeder_args_t* a = (feeder_args_t*)arg;
-    char line[1025];
+#define MAX_LEGACY 8                // legacy plugins one run may load
+
+static legacy_stage_t g_legacy[MAX_LEGACY];
+static int g_n_legacy;
+
+// a legacy plugin hands each result to a bare function, so every legacy
+// stage gets a trampoline of its own that turns the string into a message
+// for the sink it was attached to 
+static const char* legacy_forward(int slot, const char* str) {
+    msg_t m;
+    if (!str) return "null input";
+    if (msg_from_cstr(&m, str) != 0) return "out of memory";
+    const plugin_sink_t* next = &g_legacy[slot].next;
+    return next->place_msg(next->inst, &m);
+}
+
+#define LEGACY_NEXT(k) \
+    static const char* legacy_next_##k(const char* str) { return legacy_forward(k, str); }
+LEGACY_NEXT(0) LEGACY_NEXT(1) LEGACY_NEXT(2) LEGACY_NEXT(3)
+LEGACY_NEXT(4) LEGACY_NEXT(5) LEGACY_NEXT(6) LEGACY_NEXT(7)
+
+static const pf_place_t g_legacy_next[MAX_LEGACY] = {
+    legacy_next_0, legacy_next_1, legacy_next_2, legacy_next_3,
+    legacy_next_4, legacy_next_5, legacy_next_6, legacy_next_7,
+};
+
+// the legacy plugin copies what it is given, so the message is released
+// here; a borrowed view is terminated first. embedded NULs cut the line
+// short, as they always did with this SDK 
+static const char* legacy_place_msg(void* inst, msg_t* msg) {
+    legacy_stage_t* l = (legacy_stage_t*)inst;
+    const char* err;
+    if (msg_is_end(msg)) {
+        err = l->place_work("<END>");
+    } else if ((msg->flags & MSG_F_BORROWED) && msg_own(msg) != 0) {
+        err = "out of memory";
+    } else {
+        err = l->place_work(msg->data);
+    }
+    msg_release(msg);
+    return err;
+}
+
+static const char* legacy_place_msg_batch(void* inst, msg_t* msgs, int n) {
+    const char* err = NULL;
+    for (int i = 0; i < n; ++i) {
+        const char* e = legacy_place_msg(inst, &msgs[i]);
+        if (e) err = e;
+    }
+    return err;
+}
+
+static void legacy_attach(void* inst, const plugin_sink_t* next) {
+    legacy_stage_t* l = (legacy_stage_t*)inst;
+    l->next = *next;
+    l->attach(g_legacy_next[l - g_legacy]);
+}
+
+static const char* legacy_wait(void* inst) {
+    return ((legacy_stage_t*)inst)->wait_finished();
+}
+
+static const char* legacy_fini(void* inst) {
+    return ((legacy_stage_t*)inst)->fini();
+}
+
+// one worker and a blocking queue: the string SDK has no say in either 
+static const char* legacy_create(legacy_stage_t* l, const plugin_options_t* opts, void** inst) {
+    if (opts->workers > 1) return "a plugin without the instance API runs on one worker";
+    const char* err = l->init(opts->queue_size);
+    if (!err) *inst = l;
+    return err;
+}
+
+// bind stage i, whose plugin lacks plugin_instance_create, to the string
+// SDK. its one instance lives in the shared object, so it may not repeat 
+static int legacy_resolve(plugin_handle_t* plugins, int i) {
+    for (int j = 0; j < i; ++j) {
+        if (plugins[j].handle == plugins[i].handle) {
+            fprintf(stderr, "[ERROR] Plugin '%s' has no instance API and cannot appear twice\n",
+                    plugins[i].id_hint);
+            return -1;
+        }
+    }
+    if (g_n_legacy == MAX_LEGACY) {
+        fprintf(stderr, "[ERROR] More than %d plugins without the instance API\n", MAX_LEGACY);
+        return -1;
+    }
+    legacy_stage_t* l = &g_legacy[g_n_legacy];
+    if (resolve_symbol(plugins[i].handle, "plugin_init", (void**)&l->init) < 0 ||
+        resolve_symbol(plugins[i].handle, "plugin_fini", (void**)&l->fini) < 0 ||
+        resolve_symbol(plugins[i].handle, "plugin_place_work", (void**)&l->place_work) < 0 ||
+        resolve_symbol(plugins[i].handle, "plugin_attach", (void**)&l->attach) < 0 ||
+        resolve_symbol(plugins[i].handle, "plugin_wait_finished", (void**)&l->wait_finished) < 0) {
+        return -1;
+    }
+    g_n_legacy++;
+    plugins[i].legacy = l;
+    plugins[i].fini = legacy_fini;
+    plugins[i].place_msg = legacy_place_msg;
+    plugins[i].place_msg_batch = legacy_place_msg_batch;
+    plugins[i].attach = legacy_attach;
+    plugins[i].wait_finished = legacy_wait;
+    return 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#define FEED_BATCH    64            // lines handed to the first stage per call
+#define FEED_BUF_INIT (64u << 10)   // read size; grows to fit longer lines
+
+// lines parsed but not yet handed to the first stage 
+typedef struct {
+    msg_t msgs[FEED_BATCH];
+    int n;
+} feed_batch_t;
+
+// hand the pending lines over; the stage releases what it cannot queue 
+static void feed_flush(feeder_args_t* a, feed_batch_t* b) {
+    if (b->n == 0) return;
+    // a batch holds lines of one read (or of one stretch of the mapping),
+    // so one clock read serves all of them 
+    if (a->stamp) {
+        uint64_t t = now_ns();
+        for (int i = 0; i < b->n; ++i) b->msgs[i].t_ingest = b->msgs[i].t_hop = t;
+    }
+    const char* err = a->to.place_msg_batch(a->to.inst, b->msgs, b->n);
+    if (err) fprintf(stderr, "[ERROR] input feeder: %s\n", err);
+    b->n = 0;
+}
+
+// queue one line as a message: a view into the input when borrow is set,
+// else its only copy; 1 once it was <END> 
+static int feed_line(feeder_args_t* a, feed_batch_t* b, const char* line, size_t len, int borrow) {
+    msg_t* m = &b->msgs[b->n];
+    if (borrow) {
+        msg_borrow(m, line, len);
+    } else if (msg_from_bytes(m, line, len) != 0) {
+        fprintf(stderr, "[ERROR] input feeder: out of memory\n");
+        return 0;
+    }
+    msg_detect_end(m);
+    int is_end = msg_is_end(m);
+    if (++b->n == FEED_BATCH || is_end) feed_flush(a, b);
+    return is_end;
+}
+
+// lines from a stream: large read()s into one buffer, split with memchr; a
+// line longer than the buffer grows it, so every line arrives whole.
+// returns 1 once <END> was fed 
+static int feed_stream(feeder_args_t* a, feed_batch_t* batch) {
+    size_t cap = FEED_BUF_INIT;
+    size_t have = 0;              // bytes of an unfinished line at buf[0..have) 
+    char* buf = (char*)malloc(cap);
     int sent_end = 0;
 
-    while (fgets(line, sizeof(line), stdin) != NULL) {
-        strip_nl(line);
-        const char* err = a->first_stage(line);
-        if (err) fprintf(stderr, "[ERROR] input feeder: %s\n", err);
-        if (strcmp(line, "<END>") == 0) { sent_end = 1; break; }
+    while (buf && !sent_end) {
+        ssize_t r = read(a->in.fd, buf + have, cap - have);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        have += (size_t)r;
+
+        size_t pos = 0;
+        char* nl;
+        while (!sent_end && (nl = memchr(buf + pos, '\n', have - pos)) != NULL) {
+            size_t len = (size_t)(nl - (buf + pos));
+            sent_end = feed_line(a, batch, buf + pos, len, 0);
+            pos += len + 1;
+        }
+        // pass on what this read completed before blocking on the next one 
+        feed_flush(a, batch);
+
+        memmove(buf, buf + pos, have - pos);
+        have -= pos;
+        if (have == cap) {
+            char* grown = (char*)realloc(buf, cap * 2);
+            if (!grown) {
+                fprintf(stderr, "[ERROR] input feeder: line too long\n");
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
     }
-    if (!sent_end) {
-        const char* err = a->first_stage("<END>");
-        if (err) fprintf(stderr, "[ERROR] input feeder: %s\n", err);
+    // a last line without a newline still counts 
+    if (!sent_end && have > 0) sent_end = feed_line(a, batch, buf, have, 0);
+    free(buf);
+    return sent_end;
+}
+
+// lines from a mapped file: each message is a view into the mapping, so
+// nothing is copied until a stage writes 
+static int feed_mapped(feeder_args_t* a, feed_batch_t* batch) {
+    const char* p = a->in.map;
+    const char* end = p + a->in.map_len;
+    while (p < end) {
+        const char* nl = memchr(p, '\n', (size_t)(end - p));
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        if (feed_line(a, batch, p, len, 1)) return 1;
+        if (!nl) break;
+        p = nl + 1;
     }
+    return 0;
+}
+
+// thread that reads the input and forwards it to the first stage 
+static void* input_feeder(void* arg) {
+    feeder_args_t* a = (feeder_args_t*)arg;
+    feed_batch_t batch = { .n = 0 };
+
+    int sent_end = a->in.map ? feed_mapped(a, &batch) : feed_stream(a, &batch);
+    if (!sent_end) feed_line(a, &batch, "<END>", 5, 0);
+    feed_flush(a, &batch);
+
+    msg_pool_thread_flush();
     free(a);
     return NULL;
 }
 
-// reject duplicate plugin names 
-static int has_duplicate_names(char** names, int n, const char** dup_out) {
+// --input: map a regular file whole; a pipe, fifo or tty is streamed 
+static int open_input(const char* path, input_t* in) {
+    in->fd = STDIN_FILENO;
+    in->map = NULL;
+    in->map_len = 0;
+    if (!path) return 0;
+
+    in->fd = open(path, O_RDONLY);
+    if (in->fd < 0) {
+        fprintf(stderr, "[ERROR] Cannot open input '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(in->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+        if (m != MAP_FAILED) {
+            (void)madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+            in->map = (const char*)m;
+            in->map_len = (size_t)st.st_size;
+        }
+    }
+    return 0;
+}
+
+// unmap once no message can still point into the mapping 
+static void close_input(input_t* in) {
+    if (in->map) munmap((void*)in->map, in->map_len);
+    if (in->fd != STDIN_FILENO) close(in->fd);
+    in->map = NULL;
+}
+
+#define JUNCTION_CHUNK 64          // results a tee shares out per round
+
+// another holder of src for one more branch: shared, else copied. <END>
+// always gets through: if even a copy fails, a view of a static "<END>"
+// stands in, so no branch waits forever for its sentinel 
+static int junction_share(msg_t* dst, msg_t* src) {
+    static const char end[] = "<END>";
+    if (msg_share(dst, src) == 0) return 0;
+    if (msg_is_end(src)) {
+        msg_borrow(dst, end, sizeof(end) - 1);
+        dst->flags |= MSG_F_END;
+    } else if (msg_from_bytes(dst, src->data, src->len) != 0) {
+        return -1;
+    }
+    msg_copy_times(dst, src);
+    return 0;
+}
+
+// send every result to each branch: all but the last get another holder of
+// the payload (no bytes are copied), the last takes the results themselves.
+// a branch that writes in place copies first. a branch that blocks holds up
+// the others 
+static const char* tee_place_msg_batch(void* inst, msg_t* msgs, int n) {
+    junction_t* j = (junction_t*)inst;
+    const char* err = NULL;
+    msg_t shares[JUNCTION_CHUNK];
+    for (int from = 0; from < n; from += JUNCTION_CHUNK) {
+        int len = n - from < JUNCTION_CHUNK ? n - from : JUNCTION_CHUNK;
+        for (int b = 0; b + 1 < j->n; ++b) {
+            int k = 0;
+            for (int i = 0; i < len; ++i) {
+                if (junction_share(&shares[k], &msgs[from + i]) == 0) k++;
+                else err = "out of memory";
+            }
+            const char* e = k ? j->to[b].place_msg_batch(j->to[b].inst, shares, k) : NULL;
+            if (e) err = e;
+        }
+        const char* e = j->to[j->n - 1].place_msg_batch(j->to[j->n - 1].inst, msgs + from, len);
+        if (e) err = e;
+    }
+    return err;
+}
+
+static const char* tee_place_msg(void* inst, msg_t* msg) {
+    return tee_place_msg_batch(inst, msg, 1);
+}
+
+// pass results on, holding back every <END> but the one of the last input
+// to end: the stage fed must not stop while another input still sends.
+// the results ahead of an <END> are queued before it is counted, or the
+// last input's <END> could overtake them 
+static const char* merge_place_msg_batch(void* inst, msg_t* msgs, int n) {
+    junction_t* j = (junction_t*)inst;
+    const char* err = NULL;
+    int k = 0;
     for (int i = 0; i < n; ++i) {
-        for (int j = i + 1; j < n; ++j) {
-            if (strcmp(names[i], names[j]) == 0) {
-                if (dup_out) *dup_out = names[i];
-                return 1;
+        if (msg_is_end(&msgs[i]) && k > 0) {
+            const char* e = j->to[0].place_msg_batch(j->to[0].inst, msgs, k);
+            if (e) err = e;
+            k = 0;
+        }
+        if (msg_is_end(&msgs[i]) && atomic_fetch_sub(&j->ends_left, 1) > 1) {
+            msg_release(&msgs[i]);
+            continue;
+        }
+        msgs[k++] = msgs[i];
+    }
+    const char* e = k ? j->to[0].place_msg_batch(j->to[0].inst, msgs, k) : NULL;
+    return e ? e : err;
+}
+
+static const char* merge_place_msg(void* inst, msg_t* msg) {
+    return merge_place_msg_batch(inst, msg, 1);
+}
+
+// the bytes a line is routed by: one field, or the whole line; a line
+// with fewer fields has an empty key 
+static void route_key(const junction_t* j, const msg_t* m, const char** key, size_t* len) {
+    const char* p = m->data;
+    const char* end = m->data + m->len;
+    for (int f = 1; f < j->key_field && p; ++f) {
+        p = memchr(p, j->key_delim, (size_t)(end - p));
+        if (p) p++;
+    }
+    if (!p) p = end;
+    if (j->key_field > 0) {
+        const char* stop = memchr(p, j->key_delim, (size_t)(end - p));
+        if (stop) end = stop;
+    }
+    *key = p;
+    *len = (size_t)(end - p);
+}
+
+// 64-bit FNV-1a 
+static uint64_t key_hash(const char* s, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// send each line to the branch its key hashes to, so the lines of one key
+// travel one branch in order; a run of lines is grouped by branch, keeping
+// their order, and each group goes over in one batch. <END> reaches every
+// branch 
+static const char* route_place_msg_batch(void* inst, msg_t* msgs, int n) {
+    junction_t* j = (junction_t*)inst;
+    const char* err = NULL;
+    int branch[JUNCTION_CHUNK];
+    int start[MAX_STAGES + 1];
+    msg_t grouped[JUNCTION_CHUNK];
+
+    for (int from = 0; from < n;) {
+        if (msg_is_end(&msgs[from])) {
+            for (int b = 0; b + 1 < j->n; ++b) {
+                // junction_share always finds an <END> to send 
+                msg_t end;
+                (void)junction_share(&end, &msgs[from]);
+                const char* e = j->to[b].place_msg_batch(j->to[b].inst, &end, 1);
+                if (e) err = e;
+            }
+            const char* e = j->to[j->n - 1].place_msg_batch(j->to[j->n - 1].inst, &msgs[from], 1);
+            if (e) err = e;
+            from++;
+            continue;
+        }
+
+        // the lines up to the next <END>, a chunk at most 
+        int len = 0;
+        memset(start, 0, sizeof(start[0]) * (size_t)(j->n + 1));
+        while (from + len < n && len < JUNCTION_CHUNK && !msg_is_end(&msgs[from + len])) {
+            const char* key;
+            size_t key_len;
+            route_key(j, &msgs[from + len], &key, &key_len);
+            branch[len] = (int)(key_hash(key, key_len) % (uint64_t)j->n);
+            start[branch[len] + 1]++;
+            len++;
+        }
+        for (int b = 0; b < j->n; ++b) start[b + 1] += start[b];
+        for (int i = 0; i < len; ++i) grouped[start[branch[i]]++] = msgs[from + i];
+        // start[b] now ends group b 
+        for (int b = 0, first = 0; b < j->n; first = start[b++]) {
+            if (start[b] == first) continue;
+            const char* e = j->to[b].place_msg_batch(j->to[b].inst, grouped + first, start[b] - first);
+            if (e) err = e;
+        }
+        from += len;
+    }
+    return err;
+}
+
+static const char* route_place_msg(void* inst, msg_t* msg) {
+    return route_place_msg_batch(inst, msg, 1);
+}
+
+// a junction with room for n sinks, freed with the graph 
+static junction_t* junction_new(int n) {
+    junction_t* j = &g_graph.junctions[g_graph.n_junctions];
+    j->to = (plugin_sink_t*)calloc((size_t)n, sizeof(plugin_sink_t));
+    if (!j->to) return NULL;
+    j->n = n;
+    atomic_init(&j->ends_left, n);
+    g_graph.n_junctions++;
+    return j;
+}
+
+// what stage t is fed through: its own entry points, or its merge 
+static plugin_sink_t stage_sink(const plugin_handle_t* plugins, int t) {
+    plugin_sink_t s = {
+        .place_msg = plugins[t].place_msg,
+        .place_msg_batch = plugins[t].place_msg_batch,
+        .inst = plugins[t].inst,
+    };
+    if (plugins[t].merge) {
+        s.place_msg = merge_place_msg;
+        s.place_msg_batch = merge_place_msg_batch;
+        s.inst = plugins[t].merge;
+    }
+    return s;
+}
+
+// where the results of a group go (group -1: the input, to every stage
+// nothing else feeds): the one stage they feed, a tee over several (a route
+// for the input of --partitions), or nowhere; -1 if out of memory. only the last stage of a group has links
+// out of it, and they always lead to group heads 
+static int group_sink(const plugin_handle_t* plugins, int n, int group, plugin_sink_t* out) {
+    int targets[MAX_STAGES];
+    int k = 0;
+    if (group < 0) {
+        for (int i = 0; i < n; ++i) {
+            if (plugins[i].head == i && plugins[i].n_in == 0) targets[k++] = i;
+        }
+    } else {
+        for (int e = 0; e < g_graph.n_links; ++e) {
+            if (plugins[g_graph.from[e]].head == group && plugins[g_graph.to[e]].head != group) {
+                targets[k++] = g_graph.to[e];
             }
         }
     }
+
+    memset(out, 0, sizeof(*out));
+    if (k == 1) *out = stage_sink(plugins, targets[0]);
+    if (k <= 1) return 0;
+
+    junction_t* tee = junction_new(k);
+    if (!tee) return -1;
+    for (int b = 0; b < k; ++b) tee->to[b] = stage_sink(plugins, targets[b]);
+    out->place_msg = tee_place_msg;
+    out->place_msg_batch = tee_place_msg_batch;
+    out->inst = tee;
+    if (group < 0 && g_graph.partitions > 1) {
+        // sources are numbered in partition order 
+        tee->key_field = g_graph.key_field;
+        tee->key_delim = g_graph.key_delim;
+        out->place_msg = route_place_msg;
+        out->place_msg_batch = route_place_msg_batch;
+    }
     return 0;
 }
 
+// free the junctions and the --graph text, once no thread can reach them 
+static void graph_release(graph_t* g) {
+    for (int i = 0; i < g->n_junctions; ++i) free(g->junctions[i].to);
+    free(g->junctions);
+    free(g->text);
+    g->junctions = NULL;
+    g->n_junctions = 0;
+    g->text = NULL;
+}
+
+// a group head and the stages fused into it, as "a+b+c" 
+static void stage_label(const plugin_handle_t* plugins, int n, int head, char* buf, size_t cap) {
+    size_t len = (size_t)snprintf(buf, cap, "%s", plugins[head].id_hint);
+    for (int j = head + 1; j < n && len < cap; ++j) {
+        if (plugins[j].head != head) continue;
+        len += (size_t)snprintf(buf + len, cap - len, "+%s", plugins[j].id_hint);
+    }
+}
+
+// --metrics: what the table needs, shared with the SIGUSR1 thread 
+static struct {
+    plugin_handle_t* plugins;
+    int n;
+    uint64_t start_ns;
+    pthread_t sig_tid;
+    int sig_up;
+    volatile sig_atomic_t stop;
+} g_metrics;
+
+// one row per running instance; fused stages are listed with their head.
+// times are in ms summed over workers, out/s is over the whole run so far 
+static void print_metrics(void) {
+    double secs = (double)(now_ns() - g_metrics.start_ns) / 1e9;
+    flockfile(stderr);
+    fprintf(stderr, "[metrics] %-24s %4s %10s %10s %6s %6s %10s %10s %10s %12s %10s\n",
+            "stage", "wrk", "in", "out", "depth", "max",
+            "blk_in_ms", "wait_ms", "xform_ms", "out/s", "dropped");
+    for (int i = 0; i < g_metrics.n; ++i) {
+        plugin_handle_t* p = &g_metrics.plugins[i];
+        plugin_stats_t st;
+        if (p->head != i || !p->inst || !p->stats || p->stats(p->inst, &st) != NULL) continue;
+
+        char label[64];
+        stage_label(g_metrics.plugins, g_metrics.n, i, label, sizeof(label));
+        fprintf(stderr, "[metrics] %-24s %4d %10llu %10llu %6llu %6llu %10.1f %10.1f %10.1f %12.0f %10llu\n",
+                label, st.workers,
+                (unsigned long long)st.queued, (unsigned long long)st.processed,
+                (unsigned long long)st.depth, (unsigned long long)st.high_water,
+                st.put_wait_ns / 1e6, st.get_wait_ns / 1e6, st.transform_ns / 1e6,
+                secs > 0 ? (double)st.processed / secs : 0.0,
+                (unsigned long long)(st.dropped + st.evicted));
+    }
+    fflush(stderr);
+    funlockfile(stderr);
+}
+
+// SIGUSR1 is blocked everywhere and taken here, so the table is printed
+// from a normal thread rather than from a signal handler 
+static void* metrics_signal_thread(void* arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    int sig;
+    while (sigwait(&set, &sig) == 0 && !g_metrics.stop) {
+        print_metrics();
+    }
+    return NULL;
+}
+
+// block SIGUSR1 before any worker exists, so every thread inherits the mask 
+static void metrics_start(plugin_handle_t* plugins, int n) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    g_metrics.plugins = plugins;
+    g_metrics.n = n;
+    g_metrics.start_ns = now_ns();
+}
+
+// answer SIGUSR1 once every instance is created and attached 
+static void metrics_listen(void) {
+    g_metrics.sig_up = pthread_create(&g_metrics.sig_tid, NULL, metrics_signal_thread, NULL) == 0;
+}
+
+static void metrics_stop(void) {
+    if (!g_metrics.sig_up) return;
+    g_metrics.stop = 1;
+    pthread_kill(g_metrics.sig_tid, SIGUSR1);
+    pthread_join(g_metrics.sig_tid, NULL);
+    g_metrics.sig_up = 0;
+}
+
+// --latency: percentiles per running instance, end to end from each stage
+// that ends the graph; fused stages are timed with their head 
+static void print_latency(plugin_handle_t* plugins, int n) {
+    plugin_latency_t* lat = (plugin_latency_t*)malloc(sizeof(plugin_latency_t));
+    if (!lat) return;
+    fprintf(stderr, "[latency] %-24s %-10s %10s %10s %10s %10s %10s\n",
+            "stage", "hop", "count", "mean_us", "p50_us", "p99_us", "p999_us");
+    for (int i = 0; i < n; ++i) {
+        plugin_handle_t* p = &plugins[i];
+        if (p->head != i || !p->inst || !p->latency || p->latency(p->inst, lat) != NULL) continue;
+
+        char label[64];
+        stage_label(plugins, n, i, label, sizeof(label));
+        const lat_hist_t* rows[] = { &lat->queue, &lat->transform, &lat->end_to_end };
+        const char* names[] = { "queue", "transform", "end-to-end" };
+        for (int r = 0; r < 3; ++r) {
+            if (lat_hist_count(rows[r]) == 0) continue;
+            fprintf(stderr, "[latency] %-24s %-10s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+                    label, names[r], (unsigned long long)lat_hist_count(rows[r]),
+                    lat_hist_mean(rows[r]) / 1e3,
+                    lat_hist_percentile(rows[r], 50.0) / 1e3,
+                    lat_hist_percentile(rows[r], 99.0) / 1e3,
+                    lat_hist_percentile(rows[r], 99.9) / 1e3);
+        }
+    }
+    fflush(stderr);
+    free(lat);
+}
+
+// finalize created instances and close every opened handle, in reverse 
+static void release_plugins(plugin_handle_t* plugins, int n) {
+    metrics_stop();
+    for (int i = n - 1; i >= 0; --i) {
+        if (plugins[i].inst) {
+            const char* err = plugins[i].fini(plugins[i].inst);
+            if (err) {
+                fprintf(stderr, "[ERROR] finalize(%s): %s\n", plugins[i].id_hint, err);
+            }
+            plugins[i].inst = NULL;
+        }
+        if (plugins[i].handle) dlclose(plugins[i].handle);
+    }
+    free(plugins);
+    graph_release(&g_graph);
+
+    // the pool goes last: finalized queues returned their blocks to it 
+    msg_pool_destroy(g_pool);
+    g_pool = NULL;
+}
+
+// create the payload pool and hand it to every plugin; PIPELINE_ALLOC=malloc
+// keeps plain malloc. prefilled with enough typical lines to fill every
+// queue and worker batch once, so the steady state allocates nothing new 
+static void setup_msg_pool(plugin_handle_t* plugins, int n, int queue_size) {
+    const char* env = getenv("PIPELINE_ALLOC");
+    if (env && strcmp(env, "malloc") == 0) return;
+
+    g_pool = msg_pool_create();
+    if (!g_pool) return;
+    size_t lines = (size_t)(n + 1) * (size_t)queue_size + (size_t)n * 2 * 64;
+    if (lines > (1u << 16)) lines = 1u << 16;
+    (void)msg_pool_prefill(g_pool, 128, lines);
+
+    msg_use_pool(g_pool);
+    for (int i = 0; i < n; ++i) {
+        pf_use_pool_t use_pool = (pf_use_pool_t)dlsym(plugins[i].handle, "plugin_use_msg_pool");
+        if (use_pool) use_pool(g_pool);
+    }
+}
+
 int main(int argc, char* argv[]) {
     // 1) parse args + validate
-    if (argc < 3) {
-        fprintf(stderr, "[ERROR] Not enough arguments.\n");
+    int fuse_mode = 0;
+    int metrics_mode = 0;
+    int latency_mode = 0;
+    const char* input_path = NULL;
+    int overflow = PLUGIN_OVERFLOW_BLOCK;
+    int overflow_ms = 0;
+    static int pin_cpus[MAX_PIN_CPUS];
+    int n_pin = 0;
+    int spin_us = 0;
+    const char* graph_spec = NULL;
+    int partitions = 0;
+    const char* key_spec = NULL;
+    int argi = 1;
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+        if (strcmp(argv[argi], "--fuse") == 0) {
+            fuse_mode = 1;
+        } else if (strcmp(argv[argi], "--metrics") == 0) {
+            metrics_mode = 1;
+        } else if (strcmp(argv[argi], "--latency") == 0) {
+            latency_mode = 1;
+        } else if (strcmp(argv[argi], "--input") == 0 && argi + 1 < argc) {
+            input_path = argv[++argi];
+        } else if (strcmp(argv[argi], "--overflow") == 0 && argi + 1 < argc &&
+                   parse_overflow(argv[argi + 1], &overflow, &overflow_ms) == 0) {
+            argi++;
+        } else if (strcmp(argv[argi], "--pin") == 0 && argi + 1 < argc &&
+                   (n_pin = parse_cpus(argv[argi + 1], pin_cpus, MAX_PIN_CPUS)) > 0) {
+            argi++;
+        } else if (strcmp(argv[argi], "--spin") == 0 && argi + 1 < argc &&
+                   (spin_us = parse_count(argv[argi + 1], 1000000)) > 0) {
+            argi++;
+        } else if (strcmp(argv[argi], "--graph") == 0 && argi + 1 < argc) {
+            graph_spec = argv[++argi];
+        } else if (strcmp(argv[argi], "--partitions") == 0 && argi + 1 < argc &&
+                   (partitions = parse_count(argv[argi + 1], MAX_STAGES)) > 0) {
+            argi++;
+        } else if (strcmp(argv[argi], "--key") == 0 && argi + 1 < argc &&
+                   parse_key(argv[argi + 1], &g_graph.key_field, &g_graph.key_delim) == 0) {
+            key_spec = argv[++argi];
+        } else {
+            fprintf(stderr, "[ERROR] Unknown option '%s'\n", argv[argi]);
+            print_usage();
+            return 1;
+        }
+        argi++;
+    }
+    // a graph names its own stages; a chain lists them after the queue size 
+    if (graph_spec ? argc - argi != 1 : argc - argi < 2) {
+        fprintf(stderr, graph_spec ? "[ERROR] --graph takes only the queue size after it.\n"
+                                   : "[ERROR] Not enough arguments.\n");
         print_usage();
         return 1;
     }
-    int queue_size = atoi(argv[1]);
+    if ((partitions && graph_spec) || (key_spec && !partitions)) {
+        fprintf(stderr, partitions ? "[ERROR] --partitions copies a chain, not a --graph.\n"
+                                   : "[ERROR] --key needs --partitions.\n");
+        print_usage();
+        return 1;
+    }
+    int queue_size = atoi(argv[argi]);
     if (queue_size <= 0) {
         fprintf(stderr, "[ERROR] Queue size must be a positive integer.\n");
         print_usage();
         return 1;
     }
-    int num_plugins = argc - 2;
-    char** plugin_names = &argv[2];
+    // the stages and their links, in an order where every link points forward 
+    int graph_rc = graph_spec ? graph_parse(&g_graph, graph_spec)
+                 : partitions > 1 ? graph_partition(&g_graph, &argv[argi + 1], argc - argi - 1, partitions)
+                 : graph_chain(&g_graph, &argv[argi + 1], argc - argi - 1);
+    if (graph_rc != 0 || graph_sort(&g_graph) != 0) {
+        graph_release(&g_graph);
+        print_usage();
+        return 1;
+    }
+    int num_plugins = g_graph.n;
 
-    const char* dup_name = NULL;
-    if (has_duplicate_names(plugin_names, num_plugins, &dup_name)) {
-        fprintf(stderr, "[ERROR] Multiple instances of plugin '%s' are not supported in this implementation.\n", dup_name);
-        fprintf(stderr, "Hint: The assignment allows single instance per plugin; multi-instance is a bonus.\n");
+    input_t input;
+    if (open_input(input_path, &input) != 0) {
+        graph_release(&g_graph);
         return 1;
     }
 
     plugin_handle_t* plugins = (plugin_handle_t*)calloc(num_plugins, sizeof(plugin_handle_t));
-    if (!plugins) {
+    // a tee per group plus a merge per stage at most, and a tee for the input 
+    g_graph.junctions = (junction_t*)calloc((size_t)num_plugins * 2 + 1, sizeof(junction_t));
+    if (!plugins || !g_graph.junctions) {
         fprintf(stderr, "[ERROR] Failed to allocate memory for plugins\n");
+        close_input(&input);
+        release_plugins(plugins, 0);
         return 1;
     }
+    for (int e = 0; e < g_graph.n_links; ++e) {
+        plugins[g_graph.from[e]].n_out++;
+        plugins[g_graph.to[e]].n_in++;
+        plugins[g_graph.to[e]].pred = g_graph.from[e];
+    }
 
-    // 2) dlopen + dlsym for each plugin
+    // 2) dlopen + dlsym for each plugin; repeats share the mapping 
     for (int i = 0; i < num_plugins; ++i) {
+        char name[128];
         char so_path[256];
+        plugins[i].overflow = overflow;
+        plugins[i].overflow_ms = overflow_ms;
+        if (parse_stage(g_graph.spec[i], name, sizeof(name), &plugins[i]) != 0) {
+            fprintf(stderr, "[ERROR] Invalid plugin spec '%s'\n", g_graph.spec[i]);
+            close_input(&input);
+            release_plugins(plugins, i);
+            print_usage();
+            return 1;
+        }
         /* avoid './' to slightly change loading pattern */
-        snprintf(so_path, sizeof(so_path), "output/%s.so", plugin_names[i]);
+        snprintf(so_path, sizeof(so_path), "output/%s.so", name);
 
         plugins[i].handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
         if (!plugins[i].handle) {
             fprintf(stderr, "[ERROR] dlopen failed for '%s': %s\n", so_path, dlerror());
             // cleanup previously opened handles 
-            for (int j = 0; j < i; ++j) {
-                if (plugins[j].handle) dlclose(plugins[j].handle);
-            }
-            free(plugins);
+            close_input(&input);
+            release_plugins(plugins, i);
             print_usage();
             return 1;
         }
 
-        if (resolve_symbol(plugins[i].handle, "plugin_get_name", (void**)&plugins[i].get_name) < 0) {
-            for (int j = 0; j <= i; ++j) if (plugins[j].handle) dlclose(plugins[j].handle);
-            free(plugins);
-            print_usage();
-            return 1;
+        // id for logs before init 
+        plugins[i].id_hint = g_graph.id[i];
+
+        // a plugin built against the original SDK falls back to it 
+        int ok = resolve_symbol(plugins[i].handle, "plugin_get_name", (void**)&plugins[i].get_name) == 0;
+        if (ok && !resolve_optional(plugins[i].handle, "plugin_instance_create")) {
+            ok = legacy_resolve(plugins, i) == 0;
+        } else if (ok) {
+            ok = resolve_symbol(plugins[i].handle, "plugin_instance_create", (void**)&plugins[i].create) == 0 &&
+                 resolve_symbol(plugins[i].handle, "plugin_instance_fini", (void**)&plugins[i].fini) == 0 &&
+                 resolve_symbol(plugins[i].handle, "plugin_instance_place_msg", (void**)&plugins[i].place_msg) == 0 &&
+                 resolve_symbol(plugins[i].handle, "plugin_instance_place_msg_batch", (void**)&plugins[i].place_msg_batch) == 0 &&
+                 resolve_symbol(plugins[i].handle, "plugin_instance_attach", (void**)&plugins[i].attach) == 0 &&
+                 resolve_symbol(plugins[i].handle, "plugin_instance_wait_finished", (void**)&plugins[i].wait_finished) == 0;
         }
-        if (resolve_symbol(plugins[i].handle, "plugin_init", (void**)&plugins[i].init) < 0 ||
-            resolve_symbol(plugins[i].handle, "plugin_fini", (void**)&plugins[i].fini) < 0 ||
-            resolve_symbol(plugins[i].handle, "plugin_place_work", (void**)&plugins[i].place_work) < 0 ||
-            resolve_symbol(plugins[i].handle, "plugin_attach", (void**)&plugins[i].attach) < 0 ||
-            resolve_symbol(plugins[i].handle, "plugin_wait_finished", (void**)&plugins[i].wait_finished) < 0) {
-            for (int j = 0; j <= i; ++j) if (plugins[j].handle) dlclose(plugins[j].handle);
-            free(plugins);
+        if (!ok) {
+            close_input(&input);
+            release_plugins(plugins, i + 1);
             print_usage();
             return 1;
         }
 
-        // id for logs before init 
-        plugins[i].id_hint = plugin_names[i];
+        // fusion hooks are optional; without them the stage runs on its own 
+        plugins[i].get_pure = (pf_pure_t)dlsym(plugins[i].handle, "plugin_get_pure_transform");
+        plugins[i].fuse = (pf_fuse_t)dlsym(plugins[i].handle, "plugin_instance_fuse");
+        plugins[i].stats = (pf_stats_t)dlsym(plugins[i].handle, "plugin_instance_stats");
+        plugins[i].latency = (pf_latency_t)dlsym(plugins[i].handle, "plugin_instance_latency");
     }
 
-    // 3) init all plugins 
+    // 3) group stages: with --fuse a run of pure stages joins the instance
+    // of its first stage, which takes the largest worker count of the run.
+    // a run does not cross a fork or a join: each link in it is the only
+    // way out of one stage and the only way into the next. a stage with its
+    // own name@policy keeps its queue, so it may start a run but not join one 
     for (int i = 0; i < num_plugins; ++i) {
-        const char* err = plugins[i].init(queue_size);
+        plugins[i].head = i;
+        if (fuse_mode && plugins[i].get_pure) plugins[i].pure = plugins[i].get_pure();
+        int a = plugins[i].pred;
+        if (plugins[i].n_in != 1 || plugins[a].n_out != 1 || !plugins[i].pure || !plugins[a].pure ||
+            plugins[i].own_policy) {
+            continue;
+        }
+
+        plugin_handle_t* h = &plugins[plugins[a].head];
+        if (!h->fuse || h->fused == PLUGIN_FUSE_MAX) continue;
+        plugins[i].head = plugins[a].head;
+        h->fused++;
+        if (plugins[i].workers > h->workers) h->workers = plugins[i].workers;
+    }
+
+    // --pin: the reader takes the first cpu, then each instance one per worker 
+    if (n_pin > 0) {
+        int next = 1;
+        for (int i = 0; i < num_plugins; ++i) {
+            // a string-SDK stage runs its own threads; it takes no cpu 
+            if (plugins[i].head != i || plugins[i].legacy) continue;
+            plugins[i].cpus = &pin_cpus[next];
+            next += plugins[i].workers;
+        }
+        if (next > n_pin) {
+            fprintf(stderr, "[ERROR] --pin needs %d cpus (reader + workers), got %d\n", next, n_pin);
+            close_input(&input);
+            release_plugins(plugins, num_plugins);
+            return 1;
+        }
+    }
+
+    // 4) create one instance per group, all allocating from one pool 
+    setup_msg_pool(plugins, num_plugins, queue_size);
+    if (metrics_mode) metrics_start(plugins, num_plugins);
+    for (int i = 0; i < num_plugins; ++i) {
+        if (plugins[i].head != i) continue;
+        plugin_options_t opts = {
+            .queue_size = queue_size,
+            .workers = plugins[i].workers,
+            .metrics = metrics_mode,
+            .latency = latency_mode,
+            .overflow = plugins[i].overflow,
+            .overflow_timeout_ms = plugins[i].overflow_ms,
+            .spin_us = spin_us,
+            .cpus = plugins[i].cpus,
+            .producers = plugins[i].n_in,
+        };
+        const char* err = plugins[i].legacy ? legacy_create(plugins[i].legacy, &opts, &plugins[i].inst)
+                                            : plugins[i].create(&opts, &plugins[i].inst);
         if (err) {
             fprintf(stderr, "[ERROR] init(%s) returned error: %s\n", plugins[i].id_hint, err);
-            for (int j = i - 1; j >= 0; --j) {
-                if (plugins[j].fini) plugins[j].fini();
-                if (plugins[j].handle) dlclose(plugins[j].handle);
-            }
-            free(plugins);
+            close_input(&input);
+            release_plugins(plugins, num_plugins);
             return 2;
         }
+        // several stages feed this one: their <END>s meet here 
+        if (plugins[i].n_in > 1) {
+            junction_t* merge = junction_new(1);
+            if (!merge) {
+                fprintf(stderr, "[ERROR] Failed to allocate memory for plugins\n");
+                close_input(&input);
+                release_plugins(plugins, num_plugins);
+                return 1;
+            }
+            merge->to[0] = stage_sink(plugins, i);
+            atomic_init(&merge->ends_left, plugins[i].n_in);
+            plugins[i].merge = merge;
+        }
     }
 
-    // 4) attach the chain 
-    for (int i = 0; i < num_plugins - 1; ++i) {
-        plugins[i].attach(plugins[i + 1].place_work);
+    // 5) fuse group members into their head, then attach each head to the
+    // stages its group feeds 
+    for (int i = 0; i < num_plugins; ++i) {
+        if (plugins[i].head == i) continue;
+        const char* err = plugins[plugins[i].head].fuse(plugins[plugins[i].head].inst,
+                                                       &plugins[i].pure, 1);
+        if (err) {
+            fprintf(stderr, "[ERROR] fuse(%s) returned error: %s\n", plugins[i].id_hint, err);
+            close_input(&input);
+            release_plugins(plugins, num_plugins);
+            return 2;
+        }
+    }
+    // the input goes where group -1 leads 
+    plugin_sink_t first = { .inst = NULL };
+    for (int i = -1; i < num_plugins; ++i) {
+        plugin_sink_t next;
+        if (i >= 0 && plugins[i].head != i) continue;
+        if (group_sink(plugins, num_plugins, i, &next) != 0) {
+            fprintf(stderr, "[ERROR] Failed to allocate memory for plugins\n");
+            close_input(&input);
+            release_plugins(plugins, num_plugins);
+            return 1;
+        }
+        if (i < 0) first = next;
+        else if (next.place_msg) plugins[i].attach(plugins[i].inst, &next);
     }
 
-    // 5) stdin feeder thread 
+    if (metrics_mode) metrics_listen();
+
+    // 6) input feeder thread 
     pthread_t feeder_tid;
     feeder_args_t* fa = (feeder_args_t*)malloc(sizeof(feeder_args_t));
     if (!fa) {
         fprintf(stderr, "[ERROR] Failed to allocate input thread args\n");
-        for (int i = num_plugins - 1; i >= 0; --i) {
-            if (plugins[i].fini) plugins[i].fini();
-            if (plugins[i].handle) dlclose(plugins[i].handle);
-        }
-        free(plugins);
+        close_input(&input);
+        release_plugins(plugins, num_plugins);
         return 1;
     }
-    fa->first_stage = plugins[0].place_work;
+    fa->to = first;
+    fa->in = input;
+    fa->stamp = latency_mode;
 
-    if (pthread_create(&feeder_tid, NULL, stdin_feeder, fa) != 0) {
+    pthread_attr_t feeder_attr;
+    pthread_attr_init(&feeder_attr);
+    if (n_pin > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(pin_cpus[0], &set);
+        pthread_attr_setaffinity_np(&feeder_attr, sizeof(set), &set);
+    }
+    int feeder_rc = pthread_create(&feeder_tid, &feeder_attr, input_feeder, fa);
+    pthread_attr_destroy(&feeder_attr);
+    if (feeder_rc != 0) {
         fprintf(stderr, "[ERROR] Failed to create input reader thread\n");
         free(fa);
-        for (int i = num_plugins - 1; i >= 0; --i) {
-            if (plugins[i].fini) plugins[i].fini();
-            if (plugins[i].handle) dlclose(plugins[i].handle);
-        }
-        free(plugins);
+        close_input(&input);
+        release_plugins(plugins, num_plugins);
         return 1;
     }
 
-    // 6) wait for each plugin in order 
+    // 7) wait for each running instance in order 
     for (int i = 0; i < num_plugins; ++i) {
-        const char* err = plugins[i].wait_finished();
+        if (!plugins[i].inst) continue;
+        const char* err = plugins[i].wait_finished(plugins[i].inst);
         if (err) {
             fprintf(stderr, "[ERROR] await_finished(%s): %s\n", plugins[i].id_hint, err);
         }
@@ -222,18 +1479,14 @@ int main(int argc, char* argv[]) {
     // also wait for the feeder thread 
     pthread_join(feeder_tid, NULL);
 
-    // 7) finalize and cleanup in reverse order 
-    for (int i = num_plugins - 1; i >= 0; --i) {
-        if (plugins[i].fini) {
-            const char* err = plugins[i].fini();
-            if (err) {
-                fprintf(stderr, "[ERROR] finalize(%s): %s\n", plugins[i].id_hint, err);
-            }
-        }
-        if (plugins[i].handle) dlclose(plugins[i].handle);
+    // 8) final counters, then finalize and cleanup in reverse order 
+    if (metrics_mode) {
+        metrics_stop();
+        print_metrics();
     }
-
-    free(plugins);
+    if (latency_mode) print_latency(plugins, num_plugins);
+    release_plugins(plugins, num_plugins);
+    close_input(&input);
     printf("Pipeline shutdown complete\n");
     return 0;
-}
\ No newline at end of file
+}
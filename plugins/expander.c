@@ -2,32 +2,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include "plugin_common.h"
+#include "kernels/text_kernels.h"
 
 // insert a single space between characters (no trailing space)
-static const char* expand_with_spaces(const char* input_str) {
-    if (!input_str) return NULL;
-    
-    if (strcmp(input_str, "<END>") == 0){
-        return strdup("<END>");
-    }
+static int expand_with_spaces(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
 
-    size_t len = strlen(input_str);
-    if (len == 0) return strdup("");
+    size_t len = in->len;
+    if (len == 0) return msg_alloc(out, 0);
 
-    // output length: len chars + (len-1) spaces + '\0'
+    // output length: len chars + (len-1) spaces
     size_t out_len = len + (len - 1);
-    char* out = (char*)malloc(out_len + 1);
-    if (!out) return NULL;
+    if (msg_alloc(out, out_len) != 0) return -1;
 
-    size_t pos = 0;
-    for (size_t i = 0; i < len; ++i) {
-        out[pos++] = input_str[i];
-        if (i + 1 < len) out[pos++] = ' ';
-    }
-    out[pos] = '\0';
-    return out;
+    text_interleave_spaces(out->data, in->data, len);
+    return 0;
 }
 
 const char* plugin_init(int qsz) {
-    return common_plugin_init(expand_with_spaces, "expander", qsz);
-}
\ No newline at end of file
+    return common_plugin_init_pure(expand_with_spaces, "expander", qsz);
+}
@@ -1,28 +1,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include "plugin_common.h"
+#include "kernels/text_kernels.h"
 
 // reverse the input string
-static const char* flip_copy(const char* input_str) {
-    if (!input_str) return NULL;
-    
-    if (strcmp(input_str, "<END>") == 0){
-        return strdup("<END>");
-    }
+static int flip_copy(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
 
-    size_t len = strlen(input_str);
-    if (len <= 1) return strdup(input_str);
+    size_t len = in->len;
+    if (msg_alloc(out, len) != 0) return -1;
 
-    char* out = (char*)malloc(len + 1);
-    if (!out) return NULL;
+    text_reverse(out->data, in->data, len);
+    return 0;
+}
 
-    for (size_t i = 0; i < len; ++i) {
-        out[i] = input_str[len - 1 - i];
-    }
-    out[len] = '\0';
-    return out;
+// reverse in place, swapping from both ends 
+int plugin_transform_inplace(char* buf, size_t len) {
+    text_reverse_inplace(buf, len);
+    return 0;
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(flip_copy, "flipper", queue_size);
-}
\ No newline at end of file
+    return common_plugin_init_pure(flip_copy, "flipper", queue_size);
+}
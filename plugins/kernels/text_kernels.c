@@ -0,0 +1,214 @@
+#include <ctype.h>
+#include <string.h>
+#include "text_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_HAVE_X86 1
+#endif
+
+void text_upper_scalar(char* dst, const char* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = (char)toupper((unsigned char)src[i]);
+    }
+}
+
+void text_reverse_scalar(char* dst, const char* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = src[n - 1 - i];
+    }
+}
+
+// swap from both ends over buf[i..j) 
+static void reverse_inplace_scalar(char* buf, size_t i, size_t j) {
+    while (i + 1 < j) {
+        --j;
+        char c = buf[i];
+        buf[i] = buf[j];
+        buf[j] = c;
+        ++i;
+    }
+}
+
+void text_interleave_spaces_scalar(char* dst, const char* src, size_t n) {
+    size_t pos = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dst[pos++] = src[i];
+        if (i + 1 < n) dst[pos++] = ' ';
+    }
+}
+
+#if defined(TEXT_HAVE_X86) && defined(__SSE2__)
+
+// 'a'..'z' are the bytes with (b - 'a') mod 256 < 26; shifting by 0x80 turns
+// that into one signed compare. a block with any byte >= 0x80 goes through
+// toupper() instead, so a non-C locale still gets its own mapping there.
+static size_t upper_sse2(char* dst, const char* src, size_t n) {
+    const __m128i shift = _mm_set1_epi8((char)(0x80 - 'a'));
+    const __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(v) != 0) {
+            text_upper_scalar(dst + i, src + i, 16);
+            continue;
+        }
+        __m128i lower = _mm_cmplt_epi8(_mm_add_epi8(v, shift), limit);
+        v = _mm_sub_epi8(v, _mm_and_si128(lower, case_bit));
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t upper_avx2(char* dst, const char* src, size_t n) {
+    const __m256i shift = _mm256_set1_epi8((char)(0x80 - 'a'));
+    const __m256i limit = _mm256_set1_epi8((char)(0x80 + 26));
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(v) != 0) {
+            text_upper_scalar(dst + i, src + i, 32);
+            continue;
+        }
+        // no unsigned byte compare: limit > x is the same test as x < limit
+        __m256i lower = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+        v = _mm256_sub_epi8(v, _mm256_and_si256(lower, case_bit));
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+    }
+    return i;
+}
+
+// sse2 has no byte shuffle: reverse the dwords, then the words in each
+// dword, then the bytes in each word 
+static inline __m128i rev16_sse2(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// reverse within each 128-bit lane, then swap the lanes 
+__attribute__((target("avx2")))
+static inline __m256i rev32_avx2(__m256i v) {
+    const __m256i idx = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                         15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    v = _mm256_shuffle_epi8(v, idx);
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+// the reverse kernels return how many leading dst bytes they wrote 
+static size_t reverse_sse2(char* dst, const char* src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + n - i - 16));
+        _mm_storeu_si128((__m128i*)(dst + i), rev16_sse2(v));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t reverse_avx2(char* dst, const char* src, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + n - i - 32));
+        _mm256_storeu_si256((__m256i*)(dst + i), rev32_avx2(v));
+    }
+    return i;
+}
+
+// the in-place kernels swap whole blocks from both ends while two fit
+// without overlapping, and return how far they got from each end 
+static size_t reverse_inplace_sse2(char* buf, size_t n) {
+    size_t i = 0;
+    for (; n - 2 * i >= 32; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(buf + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(buf + n - i - 16));
+        _mm_storeu_si128((__m128i*)(buf + i), rev16_sse2(b));
+        _mm_storeu_si128((__m128i*)(buf + n - i - 16), rev16_sse2(a));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t reverse_inplace_avx2(char* buf, size_t n) {
+    size_t i = 0;
+    for (; n - 2 * i >= 64; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(buf + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(buf + n - i - 32));
+        _mm256_storeu_si256((__m256i*)(buf + i), rev32_avx2(b));
+        _mm256_storeu_si256((__m256i*)(buf + n - i - 32), rev32_avx2(a));
+    }
+    return i;
+}
+
+// unpacking against a vector of spaces puts one after every byte; a block
+// is only taken while a source byte follows it, so the last byte of the
+// line never gets one. returns the source bytes consumed 
+static size_t interleave_sse2(char* dst, const char* src, size_t n) {
+    const __m128i sp = _mm_set1_epi8(' ');
+    size_t i = 0;
+    for (; i + 16 < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi8(v, sp));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i + 16), _mm_unpackhi_epi8(v, sp));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t interleave_avx2(char* dst, const char* src, size_t n) {
+    const __m256i sp = _mm256_set1_epi8(' ');
+    size_t i = 0;
+    for (; i + 32 < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        // avx2 unpacks per 128-bit lane; recombine the lanes in order 
+        __m256i lo = _mm256_unpacklo_epi8(v, sp);
+        __m256i hi = _mm256_unpackhi_epi8(v, sp);
+        _mm256_storeu_si256((__m256i*)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return i;
+}
+
+#endif
+
+void text_reverse(char* dst, const char* src, size_t n) {
+    size_t done = 0;
+#if defined(TEXT_HAVE_X86) && defined(__SSE2__)
+    if (n >= 32 && __builtin_cpu_supports("avx2")) done = reverse_avx2(dst, src, n);
+    done += reverse_sse2(dst + done, src, n - done);
+#endif
+    text_reverse_scalar(dst + done, src, n - done);
+}
+
+void text_reverse_inplace(char* buf, size_t n) {
+    size_t done = 0;
+#if defined(TEXT_HAVE_X86) && defined(__SSE2__)
+    if (n >= 64 && __builtin_cpu_supports("avx2")) done = reverse_inplace_avx2(buf, n);
+    done += reverse_inplace_sse2(buf + done, n - 2 * done);
+#endif
+    reverse_inplace_scalar(buf, done, n - done);
+}
+
+void text_interleave_spaces(char* dst, const char* src, size_t n) {
+    size_t done = 0;
+#if defined(TEXT_HAVE_X86) && defined(__SSE2__)
+    if (n > 32 && __builtin_cpu_supports("avx2")) done = interleave_avx2(dst, src, n);
+    done += interleave_sse2(dst + 2 * done, src + done, n - done);
+#endif
+    text_interleave_spaces_scalar(dst + 2 * done, src + done, n - done);
+}
+
+void text_upper(char* dst, const char* src, size_t n) {
+    size_t done = 0;
+#if defined(TEXT_HAVE_X86) && defined(__SSE2__)
+    if (n >= 32 && __builtin_cpu_supports("avx2")) done = upper_avx2(dst, src, n);
+    done += upper_sse2(dst + done, src + done, n - done);
+#endif
+    text_upper_scalar(dst + done, src + done, n - done);
+}
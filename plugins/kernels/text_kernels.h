@@ -0,0 +1,25 @@
+#ifndef TEXT_KERNELS_H
+#define TEXT_KERNELS_H
+
+#include <stddef.h>
+
+// byte kernels shared by the text plugins. each has a vector path where the
+// cpu offers one and a scalar path that defines the expected output.
+
+// dst[i] = toupper(src[i]) for n bytes; dst may equal src
+void text_upper(char* dst, const char* src, size_t n);
+// reference version, one toupper() per byte
+void text_upper_scalar(char* dst, const char* src, size_t n);
+
+// dst[i] = src[n - 1 - i]; dst and src must not overlap
+void text_reverse(char* dst, const char* src, size_t n);
+void text_reverse_scalar(char* dst, const char* src, size_t n);
+// reverse buf[0..n) in place
+void text_reverse_inplace(char* buf, size_t n);
+
+// src bytes with a space between each pair, no trailing space: writes
+// 2n - 1 bytes (none for n == 0); dst and src must not overlap
+void text_interleave_spaces(char* dst, const char* src, size_t n);
+void text_interleave_spaces_scalar(char* dst, const char* src, size_t n);
+
+#endif // TEXT_KERNELS_H
@@ -1,21 +1,180 @@
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #include "plugin_common.h"
 
+static const char k_prefix[] = "[logger] ";
+
+// buffered mode (LOGGER_BUFFER=<bytes>): lines collect in one buffer that is
+// written when it fills, when the oldest line has waited LOGGER_FLUSH_MS
+// (default 50), and when a worker stops. unset or 0 keeps one write per line
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;          /* data arrived, or shutting down */
+    char* buf;
+    size_t len;
+    size_t cap;                   /* flush threshold; 0 = unbuffered */
+    long flush_ms;                /* latency bound for a buffered line */
+    struct timespec oldest;       /* when buf went from empty to non-empty */
+    pthread_t flusher;
+    int flusher_up;
+    int stop;
+} g_out = { .lock = PTHREAD_MUTEX_INITIALIZER, .flush_ms = 50 };
+
+// read the settings once; buffered mode stays off if anything is off
+static void logger_configure(void) {
+    const char* env = getenv("LOGGER_BUFFER");
+    if (!env || !*env || g_out.buf) return;
+    unsigned long cap = strtoul(env, NULL, 10);
+    if (cap == 0) return;
+
+    const char* ms = getenv("LOGGER_FLUSH_MS");
+    if (ms && *ms) g_out.flush_ms = strtol(ms, NULL, 10);
+    if (g_out.flush_ms < 0) g_out.flush_ms = 0;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_out.wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_out.buf = (char*)malloc(cap);
+    if (g_out.buf) g_out.cap = cap;
+}
+
+// write every iov byte to stdout, across short writes
+static void writev_all(struct iovec* iov, int n) {
+    while (n > 0) {
+        ssize_t w = writev(STDOUT_FILENO, iov, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        while (n > 0 && (size_t)w >= iov->iov_len) {
+            w -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char*)iov->iov_base + w;
+            iov->iov_len -= (size_t)w;
+        }
+    }
+}
+
+static void flush_locked(void) {
+    if (g_out.len == 0) return;
+    struct iovec iov = { g_out.buf, g_out.len };
+    writev_all(&iov, 1);
+    g_out.len = 0;
+}
+
+// pushes out lines that waited longer than the latency bound
+static void* flusher_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_out.lock);
+    while (!g_out.stop) {
+        if (g_out.len == 0) {
+            pthread_cond_wait(&g_out.wake, &g_out.lock);
+            continue;
+        }
+        struct timespec deadline = g_out.oldest;
+        deadline.tv_sec += g_out.flush_ms / 1000;
+        deadline.tv_nsec += (g_out.flush_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (pthread_cond_timedwait(&g_out.wake, &g_out.lock, &deadline) == ETIMEDOUT) {
+            flush_locked();
+        }
+    }
+    pthread_mutex_unlock(&g_out.lock);
+    return NULL;
+}
+
+// one line into the buffer; a line larger than the buffer goes straight out
+// with writev, behind what is already buffered
+static void buffered_write(const msg_t* in) {
+    size_t need = sizeof(k_prefix) - 1 + in->len + 1;
+
+    pthread_mutex_lock(&g_out.lock);
+    if (!g_out.flusher_up && pthread_create(&g_out.flusher, NULL, flusher_thread, NULL) == 0) {
+        g_out.flusher_up = 1;
+    }
+    if (g_out.len + need > g_out.cap) flush_locked();
+
+    if (need > g_out.cap) {
+        struct iovec iov[3] = {
+            { (void*)k_prefix, sizeof(k_prefix) - 1 },
+            { in->data, in->len },
+            { "\n", 1 },
+        };
+        writev_all(iov, 3);
+    } else {
+        if (g_out.len == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &g_out.oldest);
+            pthread_cond_signal(&g_out.wake);
+        }
+        memcpy(g_out.buf + g_out.len, k_prefix, sizeof(k_prefix) - 1);
+        g_out.len += sizeof(k_prefix) - 1;
+        memcpy(g_out.buf + g_out.len, in->data, in->len);
+        g_out.len += in->len;
+        g_out.buf[g_out.len++] = '\n';
+    }
+    pthread_mutex_unlock(&g_out.lock);
+}
+
 // print and forward the line unchanged
-const char* logger_transform(const char* input_str) {
-    if (!input_str) return NULL;
+int logger_transform(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
 
-    if (strcmp(input_str, "<END>") == 0) {
-        return strdup("<END>"); 
+    if (g_out.cap) {
+        buffered_write(in);
+        return msg_from_bytes(out, in->data, in->len);
     }
-    
-    printf("[logger] %s\n", input_str);
+
+    // write by length so embedded NULs are printed too
+    flockfile(stdout);
+    fputs(k_prefix, stdout);
+    fwrite(in->data, 1, in->len, stdout);
+    putchar('\n');
     fflush(stdout);
-    return strdup(input_str);  
+    funlockfile(stdout);
+    return msg_from_bytes(out, in->data, in->len);
+}
+
+// a worker stopped: nothing it logged may stay behind
+void plugin_flush(void) {
+    if (!g_out.cap) return;
+    pthread_mutex_lock(&g_out.lock);
+    flush_locked();
+    pthread_mutex_unlock(&g_out.lock);
+}
+
+// unload: stop the flusher and write what is left
+__attribute__((destructor))
+static void logger_unload(void) {
+    if (!g_out.cap) return;
+    pthread_mutex_lock(&g_out.lock);
+    g_out.stop = 1;
+    pthread_cond_signal(&g_out.wake);
+    pthread_mutex_unlock(&g_out.lock);
+    if (g_out.flusher_up) pthread_join(g_out.flusher, NULL);
+
+    flush_locked();
+    free(g_out.buf);
+    g_out.buf = NULL;
+    g_out.cap = 0;
+    pthread_cond_destroy(&g_out.wake);
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(logger_transform, "logger", queue_size);
+    logger_configure();
+    return common_plugin_init_msg(logger_transform, "logger", queue_size);
 }
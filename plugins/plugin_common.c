@@ -1,12 +1,32 @@
+#define _GNU_SOURCE
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include "plugin_common.h"
 #include "sync/consumer_producer.h"
+#include "sync/msg_pool.h"
 
-// single context instance per shared object 
+// default instance behind the single-instance api 
 static plugin_context_t g_ctx;
 
+// what plugin_init registered: name + transform, shared by all instances 
+static struct {
+    const char* name;
+    const char* (*transform)(const char*);
+    msg_transform_fn transform_msg;
+    int pure;
+} g_desc;
+
+// set while plugin_init runs only to fill g_desc 
+static int g_describing;
+
+// optional hooks; stay NULL unless the plugin defines them. hidden, so
+// they bind inside this shared object at link time and never to another
+// plugin's definition, however the host loads plugins 
+extern int plugin_transform_inplace(char* buf, size_t len) __attribute__((weak, visibility("hidden")));
+extern void plugin_flush(void) __attribute__((weak, visibility("hidden")));
+
 // info to stdout (non-fatal) 
 void log_info(plugin_context_t* ctx, const char* msg) {
     if (ctx && msg) {
@@ -25,42 +45,382 @@ void log_error(plugin_context_t* ctx, const char* msg) {
 
 // export name for external use 
 const char* plugin_get_name(void) {
-    return g_ctx.name;
+    return g_desc.name;
 }
 
-// shared init used by plugins to bind their transform fn 
-const char* common_plugin_init(const char* (*process_function)(const char*),
-                               const char* name,
-                               int queue_size) {
-    if (g_ctx.is_init) {
+// payloads this plugin allocates come from the host's pool 
+void plugin_use_msg_pool(struct msg_pool* pool) {
+    msg_use_pool(pool);
+}
+
+// every hop is one producer -> one consumer, so the lock-free ring is the
+// default; PIPELINE_QUEUE=locked falls back to the mutex/monitor queue
+static cp_backend_t pick_queue_backend(void) {
+    const char* env = getenv("PIPELINE_QUEUE");
+    if (env && strcmp(env, "locked") == 0) return CP_BACKEND_LOCKED;
+    return CP_BACKEND_SPSC;
+}
+
+// reorder buffer sized so every ticket the workers can hold fits at once 
+static reorder_t* reorder_create(int workers) {
+    reorder_t* r = (reorder_t*)calloc(1, sizeof(reorder_t));
+    if (!r) return NULL;
+    r->window = (uint64_t)workers * PLUGIN_BATCH_MAX * 2;
+    r->slots = (msg_t*)calloc(r->window, sizeof(msg_t));
+    r->ready = (unsigned char*)calloc(r->window, 1);
+    if (!r->slots || !r->ready) {
+        free(r->slots);
+        free(r->ready);
+        free(r);
+        return NULL;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->advanced, NULL);
+    return r;
+}
+
+static void reorder_destroy(reorder_t* r) {
+    if (!r) return;
+    for (uint64_t i = 0; i < r->window; ++i) {
+        if (r->ready[i]) msg_release(&r->slots[i]);
+    }
+    pthread_cond_destroy(&r->advanced);
+    pthread_mutex_destroy(&r->lock);
+    free(r->slots);
+    free(r->ready);
+    free(r);
+}
+
+// stop the workers started so far; they sit on a queue that never finished 
+static void workers_abort(plugin_context_t* ctx, int started) {
+    consumer_producer_signal_finished(ctx->q);
+    for (int i = 0; i < started; ++i) pthread_join(ctx->worker_tids[i], NULL);
+}
+
+// release everything context_start allocated 
+static void context_free(plugin_context_t* ctx) {
+    reorder_destroy(ctx->reorder);
+    ctx->reorder = NULL;
+    free(ctx->worker_tids);
+    ctx->worker_tids = NULL;
+    free(ctx->latency);
+    ctx->latency = NULL;
+    if (ctx->q) {
+        consumer_producer_destroy(ctx->q);
+        free(ctx->q);
+        ctx->q = NULL;
+    }
+}
+
+// bring up one instance from the registered descriptor 
+static const char* context_start(plugin_context_t* ctx, const plugin_options_t* opts) {
+    if (ctx->is_init) {
         return "already initialized";
     }
-    if (!process_function || !name || queue_size <= 0) {
+    int queue_size = opts->queue_size;
+    int workers = opts->workers > 0 ? opts->workers : 1;
+    if ((!g_desc.transform && !g_desc.transform_msg) || !g_desc.name || queue_size <= 0 ||
+        workers > PLUGIN_WORKERS_MAX || opts->overflow < PLUGIN_OVERFLOW_BLOCK ||
+        opts->overflow > PLUGIN_OVERFLOW_DROP_OLDEST || opts->overflow_timeout_ms < 0) {
         return "invalid init args";
     }
 
-    g_ctx.q = (consumer_producer_t*)malloc(sizeof(consumer_producer_t));
-    if (!g_ctx.q) {
+    ctx->q = (consumer_producer_t*)malloc(sizeof(consumer_producer_t));
+    if (!ctx->q) {
         return "queue alloc failed";
     }
 
-    if (consumer_producer_init(g_ctx.q, queue_size) != 0) {
+    // several workers or producers share one queue, and drop-oldest moves
+    // its read end from the producer side, so only the locked queue fits them 
+    int locked = workers > 1 || opts->producers > 1 || opts->overflow == PLUGIN_OVERFLOW_DROP_OLDEST;
+    cp_backend_t backend = locked ? CP_BACKEND_LOCKED : pick_queue_backend();
+    if (consumer_producer_init_backend(ctx->q, queue_size, backend) != 0) {
+        free(ctx->q);
+        ctx->q = NULL;
         return "queue init failed";
     }
+    // the PLUGIN_OVERFLOW_* values are the queue's own 
+    _Static_assert(PLUGIN_OVERFLOW_TIMEOUT == CP_OVERFLOW_TIMEOUT &&
+                   PLUGIN_OVERFLOW_DROP_OLDEST == CP_OVERFLOW_DROP_OLDEST, "overflow values differ");
+    (void)consumer_producer_set_overflow(ctx->q, (cp_overflow_t)opts->overflow, opts->overflow_timeout_ms);
+
+    if (opts->metrics) consumer_producer_enable_stats(ctx->q);
+    ctx->stats_on = opts->metrics;
+    atomic_init(&ctx->processed, 0);
+    atomic_init(&ctx->failed, 0);
+    atomic_init(&ctx->transform_ns, 0);
+
+    ctx->workers = workers;
+    ctx->worker_tids = (pthread_t*)calloc(workers, sizeof(pthread_t));
+    ctx->reorder = workers > 1 ? reorder_create(workers) : NULL;
+    ctx->latency = opts->latency ? (plugin_latency_t*)malloc(sizeof(plugin_latency_t)) : NULL;
+    if (ctx->latency) {
+        lat_hist_init(&ctx->latency->queue);
+        lat_hist_init(&ctx->latency->transform);
+        lat_hist_init(&ctx->latency->end_to_end);
+    }
+    if (!ctx->worker_tids || (workers > 1 && !ctx->reorder) || (opts->latency && !ctx->latency)) {
+        context_free(ctx);
+        return "context alloc failed";
+    }
+
+    ctx->transform = g_desc.transform;
+    ctx->transform_msg = g_desc.transform_msg;
+    ctx->transform_inplace = plugin_transform_inplace;
+    ctx->n_fused = 0;
+    ctx->name = g_desc.name;
+    memset(&ctx->next, 0, sizeof(ctx->next));
+    ctx->send_next = NULL;
+    ctx->send_next_msg = NULL;
+    ctx->send_next_msg_batch = NULL;
+    ctx->is_init = 1;
+    ctx->is_done = 0;
 
-    g_ctx.transform = process_function;
-    g_ctx.name = name;
-    g_ctx.send_next = NULL;
-    g_ctx.is_init = 1;
-    g_ctx.is_done = 0;
+    if (opts->spin_us > 0) consumer_producer_set_spin(ctx->q, (uint64_t)opts->spin_us * 1000u);
 
-    if (pthread_create(&g_ctx.worker_tid, NULL, plugin_consumer_thread, &g_ctx) != 0) {
-        return "consumer thread create failed";
+    for (int i = 0; i < workers; ++i) {
+        // a pinned worker starts on its cpu rather than moving there later 
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (opts->cpus) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(opts->cpus[i], &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        int rc = pthread_create(&ctx->worker_tids[i], &attr, plugin_consumer_thread, ctx);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            workers_abort(ctx, i);
+            context_free(ctx);
+            ctx->is_init = 0;
+            return opts->cpus ? "consumer thread create failed (cpu not available?)"
+                              : "consumer thread create failed";
+        }
     }
 
     return NULL; /* success */
 }
 
+// tear down one instance 
+static const char* context_stop(plugin_context_t* ctx) {
+    if (!ctx->is_init) return "plugin not initialized";
+
+    context_free(ctx);
+
+    ctx->is_init = 0;
+    ctx->workers = 0;
+    ctx->is_done = 0;
+    ctx->name = NULL;
+    ctx->transform = NULL;
+    ctx->transform_msg = NULL;
+    ctx->transform_inplace = NULL;
+    ctx->n_fused = 0;
+    memset(&ctx->next, 0, sizeof(ctx->next));
+    ctx->send_next = NULL;
+    ctx->send_next_msg = NULL;
+    ctx->send_next_msg_batch = NULL;
+
+    return NULL;
+}
+
+// record the descriptor; start the default instance unless just describing 
+static const char* init_context(const char* (*process_function)(const char*),
+                                msg_transform_fn process_msg,
+                                int pure,
+                                const char* name,
+                                int queue_size) {
+    if (!process_function && !process_msg) {
+        return "invalid init args";
+    }
+    g_desc.name = name;
+    g_desc.transform = process_function;
+    g_desc.transform_msg = process_msg;
+    g_desc.pure = pure;
+    if (g_describing) return NULL;
+
+    plugin_options_t opts = { .queue_size = queue_size, .workers = 1 };
+    return context_start(&g_ctx, &opts);
+}
+
+// shared init used by plugins to bind their string transform fn 
+const char* common_plugin_init(const char* (*process_function)(const char*),
+                               const char* name,
+                               int queue_size) {
+    return init_context(process_function, NULL, 0, name, queue_size);
+}
+
+// shared init used by plugins to bind their message transform fn 
+const char* common_plugin_init_msg(msg_transform_fn process_msg,
+                                   const char* name,
+                                   int queue_size) {
+    return init_context(NULL, process_msg, 0, name, queue_size);
+}
+
+// shared init used by plugins whose message transform has no side effects 
+const char* common_plugin_init_pure(msg_transform_fn process_msg,
+                                    const char* name,
+                                    int queue_size) {
+    return init_context(NULL, process_msg, 1, name, queue_size);
+}
+
+// enqueue many messages in one go; whatever cannot be queued is released 
+static const char* context_place(plugin_context_t* ctx, msg_t* msgs, int n) {
+    if (!msgs || n < 0) return "null input";
+    int placed = ctx->is_init ? consumer_producer_put_msg_batch(ctx->q, msgs, n) : 0;
+    if (placed < 0) placed = 0;
+    for (int i = placed; i < n; ++i) msg_release(&msgs[i]);
+    if (!ctx->is_init) return "plugin not initialized";
+    return placed == n ? NULL : "enqueue failed";
+}
+
+// wait until an instance finishes draining 
+static const char* context_wait(plugin_context_t* ctx) {
+    if (!ctx->is_init) return "plugin not initialized";
+
+    if (consumer_producer_wait_finished(ctx->q) != 0) {
+        return "wait finished failed";
+    }
+    // with several workers the last results may still be on their way out 
+    for (int i = 0; i < ctx->workers; ++i) {
+        if (pthread_join(ctx->worker_tids[i], NULL) != 0) {
+            return "join failed";
+        }
+    }
+    return NULL;
+}
+
+// learn name + transform once by running plugin_init in describe mode 
+static const char* describe(int queue_size) {
+    if (g_desc.transform || g_desc.transform_msg) return NULL;
+    g_describing = 1;
+    const char* err = plugin_init(queue_size);
+    g_describing = 0;
+    return err;
+}
+
+// ---- instance api ----
+
+const char* plugin_instance_create(const plugin_options_t* opts, void** out_inst) {
+    if (!opts || !out_inst) return "invalid init args";
+    *out_inst = NULL;
+
+    const char* desc_err = describe(opts->queue_size);
+    if (desc_err) return desc_err;
+
+    plugin_context_t* ctx = (plugin_context_t*)calloc(1, sizeof(plugin_context_t));
+    if (!ctx) return "context alloc failed";
+
+    const char* err = context_start(ctx, opts);
+    if (err) {
+        free(ctx);
+        return err;
+    }
+    *out_inst = ctx;
+    return NULL;
+}
+
+const char* plugin_instance_fini(void* inst) {
+    if (!inst) return "plugin not initialized";
+    const char* err = context_stop((plugin_context_t*)inst);
+    free(inst);
+    return err;
+}
+
+const char* plugin_instance_place_msg(void* inst, msg_t* msg) {
+    if (!inst) {
+        msg_release(msg);
+        return "plugin not initialized";
+    }
+    return context_place((plugin_context_t*)inst, msg, 1);
+}
+
+const char* plugin_instance_place_msg_batch(void* inst, msg_t* msgs, int n) {
+    if (!inst) {
+        for (int i = 0; msgs && i < n; ++i) msg_release(&msgs[i]);
+        return "plugin not initialized";
+    }
+    return context_place((plugin_context_t*)inst, msgs, n);
+}
+
+void plugin_instance_attach(void* inst, const plugin_sink_t* next) {
+    plugin_context_t* ctx = (plugin_context_t*)inst;
+    if (!ctx || !ctx->is_init) {
+        log_error(ctx ? ctx : &g_ctx, "attach before init");
+        return;
+    }
+    if (next) ctx->next = *next;
+}
+
+const char* plugin_instance_wait_finished(void* inst) {
+    if (!inst) return "plugin not initialized";
+    return context_wait((plugin_context_t*)inst);
+}
+
+msg_transform_fn plugin_get_pure_transform(void) {
+    if (describe(1) != NULL || !g_desc.pure) return NULL;
+    return g_desc.transform_msg;
+}
+
+const char* plugin_instance_fuse(void* inst, const msg_transform_fn* fns, int n) {
+    plugin_context_t* ctx = (plugin_context_t*)inst;
+    if (!ctx || !ctx->is_init) return "plugin not initialized";
+    if (!fns || n < 0 || ctx->n_fused + n > PLUGIN_FUSE_MAX) return "invalid fuse args";
+    for (int i = 0; i < n; ++i) {
+        if (!fns[i]) return "invalid fuse args";
+    }
+    memcpy(&ctx->fused[ctx->n_fused], fns, (size_t)n * sizeof(fns[0]));
+    ctx->n_fused += n;
+    return NULL;
+}
+
+const char* plugin_instance_stats(void* inst, plugin_stats_t* out) {
+    plugin_context_t* ctx = (plugin_context_t*)inst;
+    if (!ctx || !ctx->is_init) return "plugin not initialized";
+    if (!out) return "null output";
+    if (!ctx->stats_on) return "metrics not enabled";
+
+    cp_stats_snapshot_t qs;
+    consumer_producer_read_stats(ctx->q, &qs);
+    out->workers = ctx->workers;
+    out->queued = qs.puts;
+    out->taken = qs.gets;
+    out->depth = qs.depth;
+    out->high_water = qs.high_water;
+    out->put_wait_ns = qs.put_wait_ns;
+    out->get_wait_ns = qs.get_wait_ns;
+    out->processed = atomic_load_explicit(&ctx->processed, memory_order_relaxed);
+    out->failed = atomic_load_explicit(&ctx->failed, memory_order_relaxed);
+    out->transform_ns = atomic_load_explicit(&ctx->transform_ns, memory_order_relaxed);
+    out->dropped = qs.dropped;
+    out->evicted = qs.evicted;
+    out->timeouts = qs.timeouts;
+    return NULL;
+}
+
+const char* plugin_instance_latency(void* inst, plugin_latency_t* out) {
+    plugin_context_t* ctx = (plugin_context_t*)inst;
+    if (!ctx || !ctx->is_init) return "plugin not initialized";
+    if (!out) return "null output";
+    if (!ctx->latency) return "latency not enabled";
+    lat_hist_copy(&out->queue, &ctx->latency->queue);
+    lat_hist_copy(&out->transform, &ctx->latency->transform);
+    lat_hist_copy(&out->end_to_end, &ctx->latency->end_to_end);
+    return NULL;
+}
+
+// ---- single-instance api (the default instance) ----
+
+// enqueue a message, adopting its buffer; released here if it cannot be queued 
+const char* plugin_place_msg(msg_t* msg) {
+    return context_place(&g_ctx, msg, 1);
+}
+
+// enqueue many messages in one go; whatever cannot be queued is released 
+const char* plugin_place_msg_batch(msg_t* msgs, int n) {
+    return context_place(&g_ctx, msgs, n);
+}
+
 // enqueue input for this plugin 
 const char* plugin_place_work(const char* str) {
     if (!g_ctx.is_init) return "plugin not initialized";
@@ -72,6 +432,48 @@ const char* plugin_place_work(const char* str) {
     return NULL;
 }
 
+// enqueue a heap string without copying; freed here if it cannot be queued 
+const char* plugin_place_work_owned(char* str) {
+    if (!str) return "null input";
+    msg_t m;
+    msg_adopt_cstr(&m, str);
+    return plugin_place_msg(&m);
+}
+
+// enqueue many heap strings in one go; whatever cannot be queued is freed 
+const char* plugin_place_work_batch(char** items, int n) {
+    if (!items || n < 0) return "null input";
+    if (!g_ctx.is_init) {
+        for (int i = 0; i < n; ++i) free(items[i]);
+        return "plugin not initialized";
+    }
+
+    int placed = consumer_producer_put_batch(g_ctx.q, items, n);
+    if (placed < 0) placed = 0;
+    for (int i = placed; i < n; ++i) free(items[i]);
+    return placed == n ? NULL : "enqueue failed";
+}
+
+// trampolines: present the single-instance callbacks as a sink 
+static const char* legacy_send_str(void* inst, msg_t* m) {
+    plugin_context_t* ctx = (plugin_context_t*)inst;
+    if (msg_own(m) != 0) {
+        msg_release(m);
+        return "out of memory";
+    }
+    const char* err = ctx->send_next(m->data);
+    msg_release(m);
+    return err;
+}
+
+static const char* legacy_send_msg(void* inst, msg_t* m) {
+    return ((plugin_context_t*)inst)->send_next_msg(m);
+}
+
+static const char* legacy_send_msg_batch(void* inst, msg_t* ms, int n) {
+    return ((plugin_context_t*)inst)->send_next_msg_batch(ms, n);
+}
+
 // set the next stage callback 
 void plugin_attach(const char* (*next_place_work)(const char*)) {
     if (!g_ctx.is_init) {
@@ -79,69 +481,224 @@ void plugin_attach(const char* (*next_place_work)(const char*)) {
         return;
     }
     g_ctx.send_next = next_place_work;
+    g_ctx.next.place_msg = next_place_work ? legacy_send_str : NULL;
+    g_ctx.next.place_msg_batch = NULL;
+    g_ctx.next.inst = &g_ctx;
+}
+
+// set the next stage message callbacks; results then cross the hop without copies 
+void plugin_attach_msg(const char* (*next_place_msg)(msg_t*),
+                       const char* (*next_place_msg_batch)(msg_t*, int)) {
+    if (!g_ctx.is_init) {
+        log_error(&g_ctx, "attach before init");
+        return;
+    }
+    g_ctx.send_next_msg = next_place_msg;
+    g_ctx.send_next_msg_batch = next_place_msg_batch;
+    g_ctx.next.place_msg = next_place_msg ? legacy_send_msg : NULL;
+    g_ctx.next.place_msg_batch = next_place_msg_batch ? legacy_send_msg_batch : NULL;
+    g_ctx.next.inst = &g_ctx;
 }
 
 // wait until this plugin finishes draining 
 const char* plugin_wait_finished(void) {
-    if (!g_ctx.is_init) return "plugin not initialized";
+    return context_wait(&g_ctx);
+}
 
-    if (consumer_producer_wait_finished(g_ctx.q) != 0) {
-        return "wait finished failed";
+// finalize and release resources 
+const char* plugin_fini(void) {
+    return context_stop(&g_ctx);
+}
+
+// ---- worker ----
+
+// run the plugin's transform on one message; 0 on success. in may be
+// moved into out, which leaves it empty 
+static int transform_own(plugin_context_t* ctx, msg_t* in, msg_t* out) {
+    // a borrowed view, or a payload other branches still read, is read-only:
+    // the copying transform makes the one copy, else msg_own copies on write 
+    int writable = msg_writable(in) || !ctx->transform_msg;
+    if (ctx->transform_inplace && writable) {
+        if (msg_own(in) != 0) return -1;
+        if (ctx->transform_inplace(in->data, in->len) != 0) return -1;
+        *out = *in;
+        memset(in, 0, sizeof(*in));
+        return 0;
     }
-    if (pthread_join(g_ctx.worker_tid, NULL) != 0) {
-        return "join failed";
+    if (ctx->transform_msg) return ctx->transform_msg(in, out);
+
+    // string shim: the transform returns a fresh heap string 
+    if (msg_own(in) != 0) return -1;
+    char* res = (char*)ctx->transform(in->data);
+    if (!res) return -1;
+    msg_adopt_cstr(out, res);
+    return 0;
+}
+
+// own transform, then every fused stage on the previous result 
+static int transform_one(plugin_context_t* ctx, msg_t* in, msg_t* out) {
+    if (transform_own(ctx, in, out) != 0) return -1;
+    for (int i = 0; i < ctx->n_fused; ++i) {
+        msg_t mid = *out;
+        int rc = ctx->fused[i](&mid, out);
+        msg_release(&mid);
+        if (rc != 0) return -1;
     }
-    return NULL;
+    return 0;
 }
 
-// finalize and release resources 
-const char* plugin_fini(void) {
-    if (!g_ctx.is_init) return "plugin not initialized";
+// hand a run of results downstream in as few hops as the next stage allows 
+static void forward_results(plugin_context_t* ctx, msg_t* out, int n) {
+    if (n == 0) return;
+    if (ctx->next.place_msg_batch) {
+        (void)ctx->next.place_msg_batch(ctx->next.inst, out, n);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        // the sink adopts each result; with no next stage they end here 
+        if (ctx->next.place_msg) {
+            (void)ctx->next.place_msg(ctx->next.inst, &out[i]);
+        } else {
+            msg_release(&out[i]);
+        }
+    }
+}
 
-    consumer_producer_destroy(g_ctx.q);
-    free(g_ctx.q);
-    g_ctx.q = NULL;
+// emit the run of results that is due, in ticket order; lock held 
+static void reorder_flush_locked(plugin_context_t* ctx) {
+    reorder_t* r = ctx->reorder;
+    msg_t run[PLUGIN_BATCH_MAX];
+    int k = 0;
+    uint64_t from = r->next;
 
-    g_ctx.is_init = 0;
-    g_ctx.is_done = 0;
-    g_ctx.name = NULL;
-    g_ctx.transform = NULL;
-    g_ctx.send_next = NULL;
+    while (r->ready[r->next % r->window]) {
+        uint64_t s = r->next % r->window;
+        r->ready[s] = 0;
+        r->next++;
+        // a failed transform leaves an empty slot that only advances next 
+        if (r->slots[s].data) run[k++] = r->slots[s];
+        if (k == PLUGIN_BATCH_MAX) {
+            forward_results(ctx, run, k);
+            k = 0;
+        }
+    }
+    forward_results(ctx, run, k);
+    if (r->next != from) pthread_cond_broadcast(&r->advanced);
+}
 
-    return NULL;
+// store results by ticket and emit whatever became due; emitting under the
+// lock keeps runs from different workers from interleaving downstream 
+static void reorder_submit(plugin_context_t* ctx, msg_t* out, const uint64_t* seq, int n) {
+    reorder_t* r = ctx->reorder;
+    pthread_mutex_lock(&r->lock);
+    for (int i = 0; i < n; ++i) {
+        // a ticket a full window ahead waits for the slow worker to catch up 
+        while (seq[i] >= r->next + r->window) {
+            reorder_flush_locked(ctx);
+            if (seq[i] < r->next + r->window) break;
+            pthread_cond_wait(&r->advanced, &r->lock);
+        }
+        uint64_t s = seq[i] % r->window;
+        r->slots[s] = out[i];
+        r->ready[s] = 1;
+    }
+    reorder_flush_locked(ctx);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
 }
 
-// internal helper: check end sentinel 
-static inline int is_end(const char* s) {
-    return s && strcmp(s, "<END>") == 0;
+// results leave at t: they start their next hop, or end their trip when
+// this is the last stage 
+static void stamp_results(plugin_context_t* ctx, msg_t* out, int n, uint64_t t) {
+    int last = !ctx->next.place_msg;
+    for (int i = 0; i < n; ++i) {
+        if (!out[i].data || !out[i].t_ingest) continue;
+        out[i].t_hop = t;
+        if (last && !msg_is_end(&out[i])) {
+            lat_hist_record(&ctx->latency->end_to_end, t - out[i].t_ingest);
+        }
+    }
 }
 
-// worker thread: consumes, transforms, forwards 
+// worker thread: drains what is ready, transforms it, forwards it as a batch.
+// <END> travels with the results, so it leaves after everything before it 
 void* plugin_consumer_thread(void* arg) {
     plugin_context_t* ctx = (plugin_context_t*)arg;
+    msg_t in[PLUGIN_BATCH_MAX];
+    msg_t out[PLUGIN_BATCH_MAX];
+    uint64_t seq[PLUGIN_BATCH_MAX];
+    int done = 0;
 
-    for (;;) {
-        char* in = consumer_producer_get(ctx->q);
-        if (!in) continue;
+    while (!done) {
+        uint64_t first = 0;
+        int n = consumer_producer_get_msg_batch_seq(ctx->q, in, PLUGIN_BATCH_MAX, &first);
+        if (n == 0) break; // finished: another worker reached <END> 
 
-        if (is_end(in)) {
-            free(in);
-            break;
-        }
+        // the clock is read only with metrics or latency on: once per batch,
+        // and once per message for the latency histograms 
+        plugin_latency_t* lat = ctx->latency;
+        uint64_t t0 = (ctx->stats_on || lat) ? now_ns() : 0;
+        uint64_t t_prev = t0;
+        int k = 0;
+        int processed = 0;
+        int failed = 0;
+        for (int i = 0; i < n; ++i) {
+            // nothing after <END> is processed 
+            if (done) {
+                msg_release(&in[i]);
+                continue;
+            }
+            seq[k] = first + (uint64_t)i;
+            if (msg_is_end(&in[i])) {
+                out[k++] = in[i];
+                done = 1;
+                continue;
+            }
+            uint64_t t_ingest = in[i].t_ingest;
+            if (lat && t_ingest) lat_hist_record(&lat->queue, t0 - in[i].t_hop);
 
-        const char* out = ctx->transform(in);
-        if (ctx->send_next) {
-            (void)ctx->send_next(out);
+            int ok = transform_one(ctx, &in[i], &out[k]) == 0;
+            msg_release(&in[i]);
+            processed += ok;
+            if (lat) {
+                uint64_t t = now_ns();
+                if (t_ingest) lat_hist_record(&lat->transform, t - t_prev);
+                t_prev = t;
+            }
+            if (!ok) {
+                failed++;
+                // the reorder buffer needs every ticket, even a dropped one 
+                if (!ctx->reorder) continue;
+                memset(&out[k], 0, sizeof(out[k]));
+            }
+            out[k].t_ingest = t_ingest;
+            k++;
+        }
+        uint64_t t_end = lat ? t_prev : (ctx->stats_on ? now_ns() : 0);
+        if (lat) stamp_results(ctx, out, k, t_end);
+        if (ctx->stats_on) {
+            atomic_fetch_add_explicit(&ctx->transform_ns, t_end - t0, memory_order_relaxed);
+            atomic_fetch_add_explicit(&ctx->processed, (uint64_t)processed, memory_order_relaxed);
+            if (failed) atomic_fetch_add_explicit(&ctx->failed, (uint64_t)failed, memory_order_relaxed);
+        }
+        if (ctx->reorder) {
+            reorder_submit(ctx, out, seq, k);
         } else {
-            free((void*)out);
+            forward_results(ctx, out, k);
         }
-        free(in);
     }
 
-    if (ctx->send_next) {
-        (void)ctx->send_next("<END>");
-    }
-    consumer_producer_signal_finished(ctx->q);
+    // held-back output goes out before the stage can be seen as finished 
+    if (plugin_flush) plugin_flush();
+
+    // wakes the other workers too; they find the queue drained and leave 
+    if (done) consumer_producer_signal_finished(ctx->q);
+    msg_pool_thread_flush();
     ctx->is_done = 1;
     return NULL;
-}
\ No newline at end of file
+}
@@ -3,14 +3,46 @@
 
 #include <pthread.h>
 #include "sync/consumer_producer.h"
+#include "sync/message.h"
+#include "plugin_sdk.h"
 
-// shared plugin context 
+// most items a worker pulls from its queue per round-trip 
+#define PLUGIN_BATCH_MAX 64
+
+// most workers one instance may run 
+#define PLUGIN_WORKERS_MAX 64
+
+// puts results of several workers back into queue order before they go on 
+typedef struct {
+    pthread_mutex_t lock;                          /* held while storing and emitting */
+    pthread_cond_t advanced;                       /* next moved forward */
+    msg_t* slots;                                  /* result per ticket, indexed mod window */
+    unsigned char* ready;                          /* slot holds its ticket's result */
+    uint64_t window;                               /* tickets that may be pending at once */
+    uint64_t next;                                 /* ticket due downstream next */
+} reorder_t;
+
+// per-instance plugin context 
 typedef struct {
     const char* name;                              /* plugin display name */
     consumer_producer_t* q;                        /* input queue (heap) */
-    pthread_t worker_tid;                          /* consumer thread id */
-    const char* (*send_next)(const char*);         /* next stage place_work */
-    const char* (*transform)(const char*);         /* plugin transform fn */
+    pthread_t* worker_tids;                        /* consumer thread ids (heap) */
+    int workers;                                   /* number of consumer threads */
+    reorder_t* reorder;                            /* NULL with a single worker */
+    plugin_sink_t next;                            /* where results go */
+    const char* (*send_next)(const char*);         /* single-instance attach targets, */
+    const char* (*send_next_msg)(msg_t*);          /* reached from next via trampolines */
+    const char* (*send_next_msg_batch)(msg_t*, int);
+    const char* (*transform)(const char*);         /* plugin transform fn (strings) */
+    msg_transform_fn transform_msg;                /* plugin transform fn (messages) */
+    int (*transform_inplace)(char*, size_t);       /* preferred when the plugin has one */
+    msg_transform_fn fused[PLUGIN_FUSE_MAX];       /* later stages run in this worker */
+    int n_fused;
+    int stats_on;                                  /* keep the counters below */
+    atomic_uint_least64_t processed;               /* summed per batch over workers */
+    atomic_uint_least64_t failed;
+    atomic_uint_least64_t transform_ns;
+    plugin_latency_t* latency;                     /* NULL unless latency is kept */
     int is_init;                                   /* init state flag */
     int is_done;                                   /* finished flag */
 } plugin_context_t;
@@ -30,19 +62,85 @@ const char* common_plugin_init(const char* (*process_function)(const char*),
                                const char* name,
                                int queue_size);
 
+const char* common_plugin_init_msg(msg_transform_fn process_msg,
+                                   const char* name,
+                                   int queue_size);
+
+// as common_plugin_init_msg, for a transform without side effects; the host
+// may then fuse it into a neighbouring stage 
+const char* common_plugin_init_pure(msg_transform_fn process_msg,
+                                    const char* name,
+                                    int queue_size);
+
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size);
 
 __attribute__((visibility("default")))
 const char* plugin_fini(void);
 
+__attribute__((visibility("hidden")))
+int plugin_transform_inplace(char* buf, size_t len);
+
+__attribute__((visibility("default")))
+void plugin_use_msg_pool(struct msg_pool* pool);
+
+__attribute__((visibility("hidden")))
+void plugin_flush(void);
+
 __attribute__((visibility("default")))
 const char* plugin_place_work(const char* str);
 
+__attribute__((visibility("default")))
+const char* plugin_place_work_owned(char* str);
+
+__attribute__((visibility("default")))
+const char* plugin_place_work_batch(char** items, int n);
+
+__attribute__((visibility("default")))
+const char* plugin_place_msg(msg_t* msg);
+
+__attribute__((visibility("default")))
+const char* plugin_place_msg_batch(msg_t* msgs, int n);
+
 __attribute__((visibility("default")))
 void plugin_attach(const char* (*next_place_work)(const char*));
 
+__attribute__((visibility("default")))
+void plugin_attach_msg(const char* (*next_place_msg)(msg_t*),
+                       const char* (*next_place_msg_batch)(msg_t*, int));
+
 __attribute__((visibility("default")))
 const char* plugin_wait_finished(void);
 
-#endif 
\ No newline at end of file
+// instance api 
+__attribute__((visibility("default")))
+const char* plugin_instance_create(const plugin_options_t* opts, void** out_inst);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_fini(void* inst);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_place_msg(void* inst, msg_t* msg);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_place_msg_batch(void* inst, msg_t* msgs, int n);
+
+__attribute__((visibility("default")))
+void plugin_instance_attach(void* inst, const plugin_sink_t* next);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_wait_finished(void* inst);
+
+__attribute__((visibility("default")))
+msg_transform_fn plugin_get_pure_transform(void);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_fuse(void* inst, const msg_transform_fn* fns, int n);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_stats(void* inst, plugin_stats_t* out);
+
+__attribute__((visibility("default")))
+const char* plugin_instance_latency(void* inst, plugin_latency_t* out);
+
+#endif 
@@ -1,6 +1,25 @@
 #ifndef PLUGIN_SDK_H
 #define PLUGIN_SDK_H
 
+#include <stdint.h>
+#include "sync/lat_hist.h"
+#include "sync/message.h"
+
+/**
+* Where a stage sends its results: the next stage's instance entry points
+* plus the instance handle they are called with
+*/
+typedef struct {
+    const char* (*place_msg)(void* inst, msg_t* msg);
+    const char* (*place_msg_batch)(void* inst, msg_t* msgs, int n);   /* may be NULL */
+    void* inst;
+} plugin_sink_t;
+
+/**
+* Message transform: fill out from in, 0 on success (in stays the caller's)
+*/
+typedef int (*msg_transform_fn)(const msg_t* in, msg_t* out);
+
 /**
 * Get the plugin's name
 * @return The plugin's name (should not be modified or freed)
@@ -16,6 +35,37 @@ const char* plugin_get_name(void);
 const char* plugin_init(int queue_size);
 
 
+/**
+* Optional: transform a payload in place, for plugins that keep its length.
+When a plugin defines it, its workers call it instead of the copying transform
+and pass on the buffer they already own. Hidden inside the plugin (see
+plugin_common.h), so it is never bound to another plugin's definition.
+* @param buf Payload to rewrite (len bytes followed by a NUL)
+* @param len Payload length in bytes
+* @return 0 on success, nonzero on failure
+*/
+int plugin_transform_inplace(char* buf, size_t len);
+
+
+/**
+* Optional: push out anything the plugin holds back (buffered output).
+When a plugin defines it, each worker calls it as it stops, before the
+stage reports finished. Hidden inside the plugin, like
+plugin_transform_inplace.
+*/
+void plugin_flush(void);
+
+
+/**
+* Make this plugin allocate message payloads from a pool shared with the host
+and the other stages (see sync/msg_pool.h). Call before creating instances.
+Transforms need no change: msg_alloc draws from the pool, msg_release returns
+blocks to it from any thread.
+* @param pool Pool owned by the host, NULL for plain malloc
+*/
+void plugin_use_msg_pool(struct msg_pool* pool);
+
+
 /**
 * Finalize the plugin - terminate thread gracefully
 * @return NULL on success, error message on failure
@@ -32,6 +82,45 @@ new memory)
 const char* plugin_place_work(const char* str);
 
 
+/**
+* Place work into the plugin's queue, transferring ownership of the buffer
+* @param str Heap string (malloc); the plugin adopts it instead of copying
+and frees it, also when an error is returned
+* @return NULL on success, error message on failure
+*/
+const char* plugin_place_work_owned(char* str);
+
+
+/**
+* Place several items into the plugin's queue at once, transferring ownership
+* @param items Array of n heap strings; the plugin adopts every one of them
+and frees those it could not queue
+* @param n Number of items
+* @return NULL on success, error message on failure
+*/
+const char* plugin_place_work_batch(char** items, int n);
+
+
+/**
+* Place a message into the plugin's queue, transferring ownership
+* @param msg Message with a heap payload; the plugin adopts the payload
+(releasing it also when an error is returned) and the caller must not use
+the message afterwards. Payloads are length-delimited and may contain NULs.
+* @return NULL on success, error message on failure
+*/
+const char* plugin_place_msg(msg_t* msg);
+
+
+/**
+* Place several messages into the plugin's queue at once, transferring
+ownership of every payload
+* @param msgs Array of n messages
+* @param n Number of messages
+* @return NULL on success, error message on failure
+*/
+const char* plugin_place_msg_batch(msg_t* msgs, int n);
+
+
 /**
 * Attach this plugin to the next plugin in the chain
 * @param next_place_work Function pointer to the next plugin's place_work
@@ -40,6 +129,18 @@ function
 void plugin_attach(const char* (*next_place_work)(const char*));
 
 
+/**
+* Attach this plugin to the next plugin's message entry points, so results
+are handed over (length included) without being copied
+* @param next_place_msg Function pointer to the next plugin's place_msg
+function
+* @param next_place_msg_batch Function pointer to the next plugin's
+place_msg_batch function (may be NULL)
+*/
+void plugin_attach_msg(const char* (*next_place_msg)(msg_t*),
+                       const char* (*next_place_msg_batch)(msg_t*, int));
+
+
 /**
 * Wait until the plugin has finished processing all work and is ready to
 shutdown
@@ -48,4 +149,166 @@ shutdown
 */
 const char* plugin_wait_finished(void);
 
+
+
+/*
+* Instance api: the same plugin can run several times in one process. Each
+* instance has its own queue, workers and next stage; the functions above act
+* on a single default instance. Instances are created from one thread.
+* A plugin that exports none of it still loads: the host drives it through
+* plugin_init, plugin_place_work, plugin_attach, plugin_wait_finished and
+* plugin_fini, as one single-worker stage that appears once per chain.
+*/
+
+/* what placing work does when an instance's queue is full */
+#define PLUGIN_OVERFLOW_BLOCK       0   /* wait for room */
+#define PLUGIN_OVERFLOW_TIMEOUT     1   /* wait up to overflow_timeout_ms, then drop */
+#define PLUGIN_OVERFLOW_DROP_NEWEST 2   /* drop the new lines that do not fit */
+#define PLUGIN_OVERFLOW_DROP_OLDEST 3   /* drop the oldest queued lines to make room */
+
+/**
+* Per-instance settings
+* workers > 1 runs that many worker threads on the instance's queue; results
+still leave in input order. Only replicate transforms without side effects:
+what a transform does itself (printing, sleeping) happens in any order.
+A lossy overflow policy never drops the <END> line; dropped lines are
+counted in plugin_stats_t. spin_us trades a cpu per worker for a shorter
+wakeup; it pays off only with workers pinned to cores of their own.
+producers > 1 lets that many threads place work at once (several stages
+feeding one); their items are queued in arrival order.
+*/
+typedef struct {
+    int queue_size;   /* maximum number of items that can be queued */
+    int workers;      /* worker threads, 0 or 1 for one */
+    int metrics;      /* keep runtime counters, see plugin_instance_stats */
+    int latency;      /* keep latency histograms, see plugin_instance_latency */
+    int overflow;     /* PLUGIN_OVERFLOW_*, 0 blocks */
+    int overflow_timeout_ms;   /* for PLUGIN_OVERFLOW_TIMEOUT */
+    int spin_us;      /* workers busy-poll an empty queue this long before sleeping */
+    const int* cpus;  /* NULL, or one cpu per worker to pin it to (not kept) */
+    int producers;    /* threads placing work concurrently, 0 or 1 for one */
+} plugin_options_t;
+
+
+/**
+* Create and start a new instance of this plugin
+* @param opts Instance settings
+* @param out_inst Receives the instance handle
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_create(const plugin_options_t* opts, void** out_inst);
+
+
+/**
+* Finalize an instance and release its handle
+* @param inst Instance handle from plugin_instance_create
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_fini(void* inst);
+
+
+/**
+* Place a message into an instance's queue (same ownership rules as
+plugin_place_msg)
+* @param inst Instance handle
+* @param msg Message to adopt
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_place_msg(void* inst, msg_t* msg);
+
+
+/**
+* Place several messages into an instance's queue (same ownership rules as
+plugin_place_msg_batch)
+* @param inst Instance handle
+* @param msgs Array of n messages
+* @param n Number of messages
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_place_msg_batch(void* inst, msg_t* msgs, int n);
+
+
+/**
+* Attach an instance to the stage that receives its results
+* @param inst Instance handle
+* @param next Sink describing the next stage (copied)
+*/
+void plugin_instance_attach(void* inst, const plugin_sink_t* next);
+
+
+/**
+* Wait until an instance has finished processing all work
+* @param inst Instance handle
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_wait_finished(void* inst);
+
+
+/**
+* Get this plugin's transform if it has no side effects, so a host may call
+it from another stage's worker instead of running a stage for it
+* @return The transform, or NULL if the plugin must run as its own stage
+*/
+msg_transform_fn plugin_get_pure_transform(void);
+
+
+/* most stages one instance may run fused after its own */
+#define PLUGIN_FUSE_MAX 16
+
+/**
+* Fuse further stages into an instance: its workers apply fns in order after
+their own transform, with no queue hop in between. Call before placing work.
+* @param inst Instance handle
+* @param fns Transforms from plugin_get_pure_transform (copied)
+* @param n Number of transforms
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_fuse(void* inst, const msg_transform_fn* fns, int n);
+
+
+/**
+* Runtime counters of one instance; times are summed over its workers
+*/
+typedef struct {
+    int workers;
+    uint64_t queued;          /* items placed into the instance's queue */
+    uint64_t taken;           /* items its workers took from the queue */
+    uint64_t depth;           /* items waiting right now */
+    uint64_t high_water;      /* most items waiting at once */
+    uint64_t processed;       /* items through the transform (fused stages included) */
+    uint64_t failed;          /* transforms that returned an error */
+    uint64_t put_wait_ns;     /* time producers were blocked on a full queue */
+    uint64_t get_wait_ns;     /* time workers waited on an empty queue */
+    uint64_t transform_ns;    /* time spent transforming */
+    uint64_t dropped;         /* new items the overflow policy refused */
+    uint64_t evicted;         /* queued items it pushed out (drop-oldest) */
+    uint64_t timeouts;        /* placements that gave up waiting for room */
+} plugin_stats_t;
+
+/**
+* Read an instance's counters. Safe to call from any thread while it runs.
+* @param inst Instance handle, created with metrics set
+* @param out Receives the counters
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_stats(void* inst, plugin_stats_t* out);
+
+/**
+* Latency histograms of one instance, in ns. Only messages the host stamped
+with an ingest time (msg_t.t_ingest) are counted.
+*/
+typedef struct {
+    lat_hist_t queue;         /* handed to the stage until a worker took it */
+    lat_hist_t transform;     /* inside the transform, fused stages included */
+    lat_hist_t end_to_end;    /* ingest until it left the chain; last stage only */
+} plugin_latency_t;
+
+/**
+* Copy an instance's latency histograms. Safe to call while it runs.
+* @param inst Instance handle, created with latency set
+* @param out Receives the histograms
+* @return NULL on success, error message on failure
+*/
+const char* plugin_instance_latency(void* inst, plugin_latency_t* out);
+
 #endif
\ No newline at end of file
@@ -2,26 +2,28 @@
 #include <string.h>
 #include "plugin_common.h"
 
-static const char* rotate_right_once(const char* input_str) {
-    if (!input_str) return NULL;
+static int rotate_right_once(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
 
-    if (strcmp(input_str, "<END>") == 0) {
-        return strdup("<END>"); 
-        }
-
-    size_t len = strlen(input_str);
-    if (len == 0) return strdup("");
-
-    char* out = (char*)malloc(len + 1);
-    if (!out) return NULL;
+    size_t len = in->len;
+    if (msg_alloc(out, len) != 0) return -1;
+    if (len == 0) return 0;
 
     // last char goes to front, others shift right by one 
-    out[0] = input_str[len - 1];
-    memcpy(out + 1, input_str, len - 1);
-    out[len] = '\0';
-    return out;
+    out->data[0] = in->data[len - 1];
+    memcpy(out->data + 1, in->data, len - 1);
+    return 0;
+}
+
+// same rotation in place 
+int plugin_transform_inplace(char* buf, size_t len) {
+    if (len == 0) return 0;
+    char last = buf[len - 1];
+    memmove(buf + 1, buf, len - 1);
+    buf[0] = last;
+    return 0;
 }
 
 const char* plugin_init(int qsz) {
-    return common_plugin_init(rotate_right_once, "rotator", qsz);
-}
\ No newline at end of file
+    return common_plugin_init_pure(rotate_right_once, "rotator", qsz);
+}
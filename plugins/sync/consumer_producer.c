@@ -1,21 +1,80 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include "consumer_producer.h"
 
+// wait deadlines: CP_FOREVER blocks without limit, CP_NOW does not block
+#define CP_FOREVER 0
+#define CP_NOW     1
+
+// smallest power of two >= n
+static size_t round_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// single-writer counter update: no locked instruction needed
+static inline void stat_add(atomic_uint_least64_t* c, uint64_t v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline void stat_max(atomic_uint_least64_t* c, uint64_t v) {
+    if (v > atomic_load_explicit(c, memory_order_relaxed)) {
+        atomic_store_explicit(c, v, memory_order_relaxed);
+    }
+}
+
 int consumer_producer_init(consumer_producer_t* q, int capacity) {
+    return consumer_producer_init_backend(q, capacity, CP_BACKEND_LOCKED);
+}
+
+int consumer_producer_init_backend(consumer_producer_t* q, int capacity, cp_backend_t backend) {
     if (!q || capacity <= 0) {
         fprintf(stderr, "[ERROR][queue] invalid queue or capacity\n");
         return -1;
     }
+    if (backend != CP_BACKEND_LOCKED && backend != CP_BACKEND_SPSC) {
+        fprintf(stderr, "[ERROR][queue] unknown backend\n");
+        return -1;
+    }
 
     q->capacity = capacity;
     q->count = 0;
     q->head = 0;
     q->tail = 0;
     q->alive = 0;
+    q->backend = backend;
+    q->next_seq = 0;
+    q->stats_on = 0;
+    atomic_init(&q->stats.puts, 0);
+    atomic_init(&q->stats.high_water, 0);
+    atomic_init(&q->stats.put_wait_ns, 0);
+    atomic_init(&q->stats.gets, 0);
+    atomic_init(&q->stats.get_wait_ns, 0);
+    q->overflow = CP_OVERFLOW_BLOCK;
+    q->overflow_timeout_ns = 0;
+    atomic_init(&q->dropped, 0);
+    atomic_init(&q->evicted, 0);
+    atomic_init(&q->timeouts, 0);
+    q->spin_ns = 0;
+
+    // spsc indexes by mask, so its slot array is rounded up; capacity still bounds it
+    size_t slots = (backend == CP_BACKEND_SPSC) ? round_pow2((size_t)capacity) : (size_t)capacity;
+    q->mask = slots - 1;
+    atomic_init(&q->rd, 0);
+    atomic_init(&q->wr, 0);
+    atomic_init(&q->consumer_parked, 0);
+    atomic_init(&q->producer_parked, 0);
 
-    q->items = (char**)malloc(sizeof(char*) * capacity);
+    q->items = (msg_t*)calloc(slots, sizeof(msg_t));
     if (!q->items) {
         fprintf(stderr, "[ERROR][queue] items alloc failed\n");
         return -1;
@@ -71,69 +130,446 @@ void consumer_producer_destroy(consumer_producer_t* q) {
     monitor_destroy(&q->not_full_monitor);
     pthread_mutex_destroy(&q->lock);
 
-    // free buffer
+    // release anything still queued, then free buffer
+    if (q->items) {
+        if (q->backend == CP_BACKEND_SPSC) {
+            for (size_t i = atomic_load(&q->rd); i != atomic_load(&q->wr); ++i) {
+                msg_release(&q->items[i & q->mask]);
+            }
+        } else {
+            for (int i = 0; i < q->count; ++i) {
+                msg_release(&q->items[(q->head + i) % q->capacity]);
+            }
+        }
+    }
+    atomic_store(&q->rd, 0);
+    atomic_store(&q->wr, 0);
     free(q->items);
     q->items = NULL;
     q->capacity = q->count = q->head = q->tail = 0;
 }
 
-int consumer_producer_put(consumer_producer_t* q, const char* item) {
-    if (!q || !item) {
-        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
-        return -1;
+// ---- spsc backend ----
+// the fast path touches only rd/wr; a side that finds the ring empty/full
+// announces itself in *_parked and sleeps on the matching monitor. the other
+// side publishes its index, fences, and takes the lock only if someone parked.
+
+static void spsc_wake(consumer_producer_t* q, atomic_int* parked, monitor_t* m) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(parked, memory_order_relaxed)) {
+        pthread_mutex_lock(&q->lock);
+        monitor_signal_locked(m, &q->lock);
+        pthread_mutex_unlock(&q->lock);
     }
+}
 
-    pthread_mutex_lock(&q->lock);
-    // block while full and alive
-    while (q->alive && (q->count == q->capacity)) {
-        if (monitor_wait_locked(&q->not_full_monitor, &q->lock) != 0) {
-            pthread_mutex_unlock(&q->lock);
-            return -1;
+// blocks until the ring has room past wr; -1 once the queue is finished,
+// MONITOR_TIMEDOUT once the deadline passed
+static int spsc_wait_space(consumer_producer_t* q, size_t wr, uint64_t deadline) {
+    while (wr - atomic_load_explicit(&q->rd, memory_order_acquire) >= (size_t)q->capacity) {
+        if (!q->alive) return -1;
+        if (deadline == CP_NOW) return MONITOR_TIMEDOUT;
+        uint64_t t0 = q->stats_on ? now_ns() : 0;
+        pthread_mutex_lock(&q->lock);
+        atomic_store(&q->producer_parked, 1);
+        int rc = 0;
+        while (q->alive && wr - atomic_load(&q->rd) >= (size_t)q->capacity) {
+            if ((rc = monitor_timedwait_locked(&q->not_full_monitor, &q->lock, deadline)) != 0) break;
         }
+        atomic_store(&q->producer_parked, 0);
+        pthread_mutex_unlock(&q->lock);
+        if (q->stats_on) stat_add(&q->stats.put_wait_ns, now_ns() - t0);
+        if (rc == MONITOR_TIMEDOUT) return rc;
     }
-    if (!q->alive) { pthread_mutex_unlock(&q->lock); return -1; }
-
-    // copy item into ring buffer
-    char* copy = strdup(item);
-    if (!copy) { pthread_mutex_unlock(&q->lock); return -1; }
+    return q->alive ? 0 : -1;
+}
 
-    q->items[q->tail] = copy;
-    q->tail = (q->tail + 1) % q->capacity;
-    q->count++;
+// busy-poll the write index for up to spin_ns; 1 once an item is readable
+static int spsc_poll_items(consumer_producer_t* q, size_t rd) {
+    uint64_t until = now_ns() + q->spin_ns;
+    for (unsigned i = 1; q->alive; ++i) {
+        if (atomic_load_explicit(&q->wr, memory_order_acquire) != rd) return 1;
+        if ((i & 63) == 0 && now_ns() >= until) return 0;
+    }
+    return 0;
+}
 
-    // notify a potential getter
-    monitor_signal_locked(&q->not_empty_monitor, &q->lock);
-    pthread_mutex_unlock(&q->lock);
+// blocks until an item is readable at rd; -1 once finished and drained,
+// MONITOR_TIMEDOUT once the deadline passed
+static int spsc_wait_items(consumer_producer_t* q, size_t rd, uint64_t deadline) {
+    if (q->spin_ns && deadline != CP_NOW && atomic_load_explicit(&q->wr, memory_order_acquire) == rd) {
+        uint64_t t0 = q->stats_on ? now_ns() : 0;
+        (void)spsc_poll_items(q, rd);
+        if (q->stats_on) stat_add(&q->stats.get_wait_ns, now_ns() - t0);
+    }
+    while (atomic_load_explicit(&q->wr, memory_order_acquire) == rd) {
+        // a finished queue still drains what it holds
+        if (!q->alive && atomic_load(&q->wr) == rd) return -1;
+        if (deadline == CP_NOW) return MONITOR_TIMEDOUT;
+        uint64_t t0 = q->stats_on ? now_ns() : 0;
+        pthread_mutex_lock(&q->lock);
+        atomic_store(&q->consumer_parked, 1);
+        int rc = 0;
+        while (q->alive && atomic_load(&q->wr) == rd) {
+            if ((rc = monitor_timedwait_locked(&q->not_empty_monitor, &q->lock, deadline)) != 0) break;
+        }
+        atomic_store(&q->consumer_parked, 0);
+        pthread_mutex_unlock(&q->lock);
+        if (q->stats_on) stat_add(&q->stats.get_wait_ns, now_ns() - t0);
+        if (rc == MONITOR_TIMEDOUT) return rc;
+        if (rc != 0) return -1;
+    }
     return 0;
 }
 
-char* consumer_producer_get(consumer_producer_t* q) {
-    if (!q) return NULL;
+static int spsc_put_batch(consumer_producer_t* q, msg_t* items, int n, uint64_t deadline) {
+    size_t wr = atomic_load_explicit(&q->wr, memory_order_relaxed);
+    int placed = 0;
+
+    while (placed < n) {
+        if (spsc_wait_space(q, wr, deadline) != 0) break;
+
+        // fill every free slot we can see, publish them with one store
+        size_t space = (size_t)q->capacity - (wr - atomic_load_explicit(&q->rd, memory_order_acquire));
+        int before = placed;
+        while (space-- > 0 && placed < n) {
+            q->items[wr & q->mask] = items[placed++];
+            wr++;
+        }
+        if (q->stats_on) stat_add(&q->stats.puts, (uint64_t)(placed - before));
+        atomic_store_explicit(&q->wr, wr, memory_order_release);
+        spsc_wake(q, &q->consumer_parked, &q->not_empty_monitor);
+        if (q->stats_on) {
+            stat_max(&q->stats.high_water, wr - atomic_load_explicit(&q->rd, memory_order_acquire));
+        }
+    }
+    return placed;
+}
+
+static int spsc_get_batch(consumer_producer_t* q, msg_t* out, int max, uint64_t* first_seq,
+                          uint64_t deadline) {
+    size_t rd = atomic_load_explicit(&q->rd, memory_order_relaxed);
+    if (spsc_wait_items(q, rd, deadline) != 0) return 0;
+    if (first_seq) *first_seq = rd;
+
+    size_t avail = atomic_load_explicit(&q->wr, memory_order_acquire) - rd;
+    int taken = 0;
+    while (taken < max && avail-- > 0) {
+        out[taken++] = q->items[rd & q->mask];
+        rd++;
+    }
+    atomic_store_explicit(&q->rd, rd, memory_order_release);
+    if (q->stats_on) stat_add(&q->stats.gets, (uint64_t)taken);
+
+    spsc_wake(q, &q->producer_parked, &q->not_full_monitor);
+    return taken;
+}
+
+// ---- locked backend ----
+
+static int locked_put_batch(consumer_producer_t* q, msg_t* items, int n, uint64_t deadline) {
+    int placed = 0;
+
+    pthread_mutex_lock(&q->lock);
+    while (placed < n) {
+        // block while full and alive, until the deadline
+        uint64_t t0 = (q->stats_on && q->count == q->capacity) ? now_ns() : 0;
+        int rc = 0;
+        while (q->alive && (q->count == q->capacity)) {
+            if (deadline == CP_NOW) {
+                rc = MONITOR_TIMEDOUT;
+                break;
+            }
+            if ((rc = monitor_timedwait_locked(&q->not_full_monitor, &q->lock, deadline)) != 0) break;
+        }
+        if (t0) stat_add(&q->stats.put_wait_ns, now_ns() - t0);
+        if (rc == MONITOR_TIMEDOUT) break;
+        if (rc != 0) {
+            pthread_mutex_unlock(&q->lock);
+            return placed;
+        }
+        if (!q->alive) {
+            monitor_signal_locked(&q->not_full_monitor, &q->lock);
+            break;
+        }
+
+        // store as many of the caller's messages as fit
+        int before = placed;
+        while (placed < n && q->count < q->capacity) {
+            q->items[q->tail] = items[placed++];
+            q->tail = (q->tail + 1) % q->capacity;
+            q->count++;
+        }
+        if (q->stats_on) {
+            stat_add(&q->stats.puts, (uint64_t)(placed - before));
+            stat_max(&q->stats.high_water, (uint64_t)q->count);
+        }
+
+        // notify a potential getter
+        monitor_signal_locked(&q->not_empty_monitor, &q->lock);
+    }
+    // pass leftover space on to another blocked putter
+    if (q->count < q->capacity) monitor_signal_locked(&q->not_full_monitor, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+    return placed;
+}
 
+static int locked_get_batch(consumer_producer_t* q, msg_t* out, int max, uint64_t* first_seq,
+                            uint64_t deadline) {
     pthread_mutex_lock(&q->lock);
-    // block while empty and alive
+    // block while empty and alive, until the deadline
+    uint64_t t0 = (q->stats_on && q->count == 0) ? now_ns() : 0;
     while (q->alive && (q->count == 0)) {
-        if (monitor_wait_locked(&q->not_empty_monitor, &q->lock) != 0) {
+        int rc = deadline == CP_NOW ? MONITOR_TIMEDOUT
+                                    : monitor_timedwait_locked(&q->not_empty_monitor, &q->lock, deadline);
+        if (rc != 0) {
+            if (t0) stat_add(&q->stats.get_wait_ns, now_ns() - t0);
             pthread_mutex_unlock(&q->lock);
-            return NULL;
+            return 0;
         }
     }
-    // if dead and empty, nothing to return
+    if (t0) stat_add(&q->stats.get_wait_ns, now_ns() - t0);
+    // if dead and empty, nothing to return; pass the wake-up on so every
+    // other blocked getter sees the end too
     if (!q->alive && q->count == 0) {
+        monitor_signal_locked(&q->not_empty_monitor, &q->lock);
         pthread_mutex_unlock(&q->lock);
-        return NULL;
+        return 0;
     }
 
-    // take one item from ring buffer
-    char* item = q->items[q->head];
-    q->items[q->head] = NULL;
-    q->head = (q->head + 1) % q->capacity;
-    q->count--;
+    // take up to max items from ring buffer; they get consecutive tickets
+    if (first_seq) *first_seq = q->next_seq;
+    int taken = 0;
+    while (taken < max && q->count > 0) {
+        out[taken++] = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+    }
+    q->next_seq += (uint64_t)taken;
+    if (q->stats_on) stat_add(&q->stats.gets, (uint64_t)taken);
 
-    // notify a potential putter
+    // notify a potential putter; leftovers go to another getter
     monitor_signal_locked(&q->not_full_monitor, &q->lock);
+    if (q->count > 0) monitor_signal_locked(&q->not_empty_monitor, &q->lock);
     pthread_mutex_unlock(&q->lock);
-    return item;
+    return taken;
+}
+
+// drop-oldest: make room by releasing the oldest queued items. the <END>
+// sentinel and whatever follows it wait for room as a blocking put does
+static int locked_put_evict(consumer_producer_t* q, msg_t* items, int n) {
+    int placed = 0;
+    uint64_t evicted = 0;
+
+    pthread_mutex_lock(&q->lock);
+    while (placed < n && q->alive && !msg_is_end(&items[placed])) {
+        if (q->count == q->capacity) {
+            msg_release(&q->items[q->head]);
+            q->head = (q->head + 1) % q->capacity;
+            q->count--;
+            evicted++;
+        }
+        q->items[q->tail] = items[placed++];
+        q->tail = (q->tail + 1) % q->capacity;
+        q->count++;
+    }
+    if (q->stats_on) {
+        stat_add(&q->stats.puts, (uint64_t)placed);
+        stat_max(&q->stats.high_water, (uint64_t)q->count);
+    }
+    if (placed > 0) monitor_signal_locked(&q->not_empty_monitor, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+
+    if (evicted) atomic_fetch_add_explicit(&q->evicted, evicted, memory_order_relaxed);
+    if (placed < n && q->alive) placed += locked_put_batch(q, items + placed, n - placed, CP_FOREVER);
+    return placed;
+}
+
+static int put_until(consumer_producer_t* q, msg_t* items, int n, uint64_t deadline) {
+    if (q->backend == CP_BACKEND_SPSC) return spsc_put_batch(q, items, n, deadline);
+    return locked_put_batch(q, items, n, deadline);
+}
+
+static int get_until(consumer_producer_t* q, msg_t* out, int max, uint64_t* first_seq, uint64_t deadline) {
+    if (q->backend == CP_BACKEND_SPSC) return spsc_get_batch(q, out, max, first_seq, deadline);
+    return locked_get_batch(q, out, max, first_seq, deadline);
+}
+
+// drop-newest and timeout: queue what fits by the deadline, release the
+// rest. <END> is kept and waits for room, so shutdown still goes through
+static int put_or_drop(consumer_producer_t* q, msg_t* items, int n, uint64_t deadline) {
+    int placed = put_until(q, items, n, deadline);
+    if (placed == n || !q->alive) return placed;
+    if (deadline != CP_NOW) atomic_fetch_add_explicit(&q->timeouts, 1, memory_order_relaxed);
+
+    uint64_t dropped = 0;
+    for (int i = placed; i < n; ++i) {
+        if (msg_is_end(&items[i])) {
+            // finished meanwhile: the caller keeps i..n as with any put
+            if (put_until(q, &items[i], 1, CP_FOREVER) != 1) {
+                atomic_fetch_add_explicit(&q->dropped, dropped, memory_order_relaxed);
+                return i;
+            }
+            continue;
+        }
+        msg_release(&items[i]);
+        dropped++;
+    }
+    atomic_fetch_add_explicit(&q->dropped, dropped, memory_order_relaxed);
+    return n;
+}
+
+static uint64_t deadline_in(int timeout_ms) {
+    return now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000u;
+}
+
+// ---- message api ----
+
+int consumer_producer_put_msg(consumer_producer_t* q, msg_t* m) {
+    if (!q || !m || !m->data) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+    return consumer_producer_put_msg_batch(q, m, 1) == 1 ? 0 : -1;
+}
+
+int consumer_producer_put_msg_batch(consumer_producer_t* q, msg_t* items, int n) {
+    if (!q || !items || n < 0) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+    switch (q->overflow) {
+    case CP_OVERFLOW_TIMEOUT:     return put_or_drop(q, items, n, now_ns() + q->overflow_timeout_ns);
+    case CP_OVERFLOW_DROP_NEWEST: return put_or_drop(q, items, n, CP_NOW);
+    case CP_OVERFLOW_DROP_OLDEST: return locked_put_evict(q, items, n);
+    default:                      return put_until(q, items, n, CP_FOREVER);
+    }
+}
+
+int consumer_producer_put_msg_timed(consumer_producer_t* q, msg_t* m, int timeout_ms) {
+    if (!q || !m || !m->data) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+    if (put_until(q, m, 1, deadline_in(timeout_ms)) == 1) return 0;
+    return q->alive ? 1 : -1;
+}
+
+int consumer_producer_get_msg_timed(consumer_producer_t* q, msg_t* out, int timeout_ms) {
+    if (!q || !out) return -1;
+    if (get_until(q, out, 1, NULL, deadline_in(timeout_ms)) == 1) return 0;
+    return q->alive ? 1 : -1;
+}
+
+void consumer_producer_set_spin(consumer_producer_t* q, uint64_t spin_ns) {
+    if (!q) return;
+    q->spin_ns = spin_ns;
+    monitor_set_poll(&q->not_empty_monitor, spin_ns);
+}
+
+int consumer_producer_set_overflow(consumer_producer_t* q, cp_overflow_t policy, int timeout_ms) {
+    if (!q || policy < CP_OVERFLOW_BLOCK || policy > CP_OVERFLOW_DROP_OLDEST || timeout_ms < 0) return -1;
+    if (policy == CP_OVERFLOW_DROP_OLDEST && q->backend == CP_BACKEND_SPSC) return -1;
+    q->overflow = policy;
+    q->overflow_timeout_ns = (uint64_t)timeout_ms * 1000000u;
+    return 0;
+}
+
+int consumer_producer_get_msg(consumer_producer_t* q, msg_t* out) {
+    return consumer_producer_get_msg_batch(q, out, 1) == 1 ? 0 : -1;
+}
+
+int consumer_producer_get_msg_batch(consumer_producer_t* q, msg_t* out, int max) {
+    return consumer_producer_get_msg_batch_seq(q, out, max, NULL);
+}
+
+int consumer_producer_get_msg_batch_seq(consumer_producer_t* q, msg_t* out, int max, uint64_t* first_seq) {
+    if (!q || !out || max <= 0) return 0;
+    return get_until(q, out, max, first_seq, CP_FOREVER);
+}
+
+// ---- string api (shims over the message api) ----
+
+int consumer_producer_put(consumer_producer_t* q, const char* item) {
+    if (!q || !item) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+
+    // copy outside the lock, then hand the copy over
+    msg_t m;
+    if (msg_from_cstr(&m, item) != 0) return -1;
+    if (consumer_producer_put_msg(q, &m) != 0) {
+        msg_release(&m);
+        return -1;
+    }
+    return 0;
+}
+
+int consumer_producer_put_owned(consumer_producer_t* q, char* item) {
+    if (!q || !item) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+    msg_t m;
+    msg_adopt_cstr(&m, item);
+    return consumer_producer_put_msg(q, &m);
+}
+
+int consumer_producer_put_batch(consumer_producer_t* q, char** items, int n) {
+    if (!q || !items || n < 0) {
+        fprintf(stderr, "[ERROR][queue] put: invalid args\n");
+        return -1;
+    }
+    msg_t ms[CP_SHIM_CHUNK];
+    int placed = 0;
+    while (placed < n) {
+        int k = (n - placed < CP_SHIM_CHUNK) ? n - placed : CP_SHIM_CHUNK;
+        for (int i = 0; i < k; ++i) msg_adopt_cstr(&ms[i], items[placed + i]);
+        int got = consumer_producer_put_msg_batch(q, ms, k);
+        placed += got;
+        if (got < k) break;
+    }
+    return placed;
+}
+
+char* consumer_producer_get(consumer_producer_t* q) {
+    msg_t m;
+    if (consumer_producer_get_msg(q, &m) != 0) return NULL;
+    return msg_take_cstr(&m);
+}
+
+int consumer_producer_get_batch(consumer_producer_t* q, char** out, int max) {
+    if (!q || !out || max <= 0) return 0;
+    msg_t ms[CP_SHIM_CHUNK];
+    int n = consumer_producer_get_msg_batch(q, ms, max < CP_SHIM_CHUNK ? max : CP_SHIM_CHUNK);
+    for (int i = 0; i < n; ++i) out[i] = msg_take_cstr(&ms[i]);
+    return n;
+}
+
+// ---- stats ----
+
+void consumer_producer_enable_stats(consumer_producer_t* q) {
+    if (q) q->stats_on = 1;
+}
+
+void consumer_producer_read_stats(const consumer_producer_t* q, cp_stats_snapshot_t* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!q) return;
+    out->dropped = atomic_load_explicit(&q->dropped, memory_order_relaxed);
+    out->evicted = atomic_load_explicit(&q->evicted, memory_order_relaxed);
+    out->timeouts = atomic_load_explicit(&q->timeouts, memory_order_relaxed);
+    if (!q->stats_on) return;
+    out->gets = atomic_load_explicit(&q->stats.gets, memory_order_relaxed);
+    out->puts = atomic_load_explicit(&q->stats.puts, memory_order_relaxed);
+    out->high_water = atomic_load_explicit(&q->stats.high_water, memory_order_relaxed);
+    out->put_wait_ns = atomic_load_explicit(&q->stats.put_wait_ns, memory_order_relaxed);
+    out->get_wait_ns = atomic_load_explicit(&q->stats.get_wait_ns, memory_order_relaxed);
+    // the two sides are read at slightly different moments; evicted items
+    // left without being taken
+    uint64_t gone = out->gets + out->evicted;
+    out->depth = out->puts > gone ? out->puts - gone : 0;
 }
 
 void consumer_producer_signal_finished(consumer_producer_t* q) {
@@ -2,31 +2,147 @@
 #define CONSUMER_PRODUCER_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "monitor.h"
+#include "message.h"
 
-// bounded queue for strings with external lock + monitors
+#define CP_CACHE_LINE 64
+#define CP_SHIM_CHUNK 64          // messages converted per step by the string batch shims
+
+// queue backends; both share the same consumer_producer_* api
+typedef enum {
+    CP_BACKEND_LOCKED = 0,        // single mutex + monitors, any number of threads
+    CP_BACKEND_SPSC   = 1         // lock-free ring, exactly one producer and one consumer
+} cp_backend_t;
+
+// what a put does when the queue is full
+typedef enum {
+    CP_OVERFLOW_BLOCK       = 0,  // wait for room (default)
+    CP_OVERFLOW_TIMEOUT     = 1,  // wait up to the queue's timeout, then drop the rest
+    CP_OVERFLOW_DROP_NEWEST = 2,  // never wait: drop what does not fit
+    CP_OVERFLOW_DROP_OLDEST = 3   // never wait: push the oldest items out (locked backend only)
+} cp_overflow_t;
+
+// runtime counters, kept only once stats are enabled. each half has a single
+// writer at a time (its side of an spsc ring, or whoever holds the lock), so
+// updates are plain relaxed stores and a reader may look at any moment
+typedef struct {
+    // producer side
+    atomic_uint_least64_t puts;         // items queued
+    atomic_uint_least64_t high_water;   // most items queued at once
+    atomic_uint_least64_t put_wait_ns;  // producers blocked on not_full
+    char pad[CP_CACHE_LINE - 3 * sizeof(atomic_uint_least64_t)];
+    // consumer side
+    atomic_uint_least64_t gets;         // items taken
+    atomic_uint_least64_t get_wait_ns;  // consumers waiting on not_empty
+} cp_stats_t;
+
+// a consistent-enough copy of the counters for printing
+typedef struct {
+    uint64_t puts;
+    uint64_t gets;
+    uint64_t depth;                     // items queued right now
+    uint64_t high_water;
+    uint64_t put_wait_ns;
+    uint64_t get_wait_ns;
+    uint64_t dropped;                   // overflow counters, kept whether or not
+    uint64_t evicted;                   // stats are enabled
+    uint64_t timeouts;
+} cp_stats_snapshot_t;
+
+// bounded queue of messages with external lock + monitors
 typedef struct {
-    char** items;                 // array of string pointers (heap)
+    msg_t* items;                 // array of messages, stored by value (heap)
     int capacity;                 // max number of items
-    int count;                    // current number of items
-    int head;                     // index of next item to take
-    int tail;                     // index of next slot to fill
-    int alive;                    // 1 = running, 0 = finished
+    int count;                    // current number of items (locked backend)
+    int head;                     // index of next item to take (locked backend)
+    int tail;                     // index of next slot to fill (locked backend)
+    atomic_int alive;             // 1 = running, 0 = finished
+    cp_backend_t backend;         // selected at init
+    uint64_t next_seq;            // dequeue ticket of the next item (locked backend)
 
-    pthread_mutex_t lock;         // single lock for all ops
+    pthread_mutex_t lock;         // single lock for all ops (spsc: parking only)
 
     monitor_t not_full_monitor;   // signal when space is available
     monitor_t not_empty_monitor;  // signal when item is available
     monitor_t finished_monitor;   // signal final shutdown
+
+    // spsc ring: slots are a power of two, counters run free and are masked;
+    // consumer and producer state sit on separate cache lines
+    size_t mask;
+    char   pad0[CP_CACHE_LINE];
+    atomic_size_t rd;             // next slot to read (written by consumer only)
+    atomic_int    consumer_parked;
+    char   pad1[CP_CACHE_LINE - sizeof(atomic_size_t) - sizeof(atomic_int)];
+    atomic_size_t wr;             // next slot to write (written by producer only)
+    atomic_int    producer_parked;
+    char   pad2[CP_CACHE_LINE - sizeof(atomic_size_t) - sizeof(atomic_int)];
+
+    int stats_on;                 // set before any traffic, never cleared
+    cp_stats_t stats;
+
+    cp_overflow_t overflow;       // set before any traffic
+    uint64_t overflow_timeout_ns; // CP_OVERFLOW_TIMEOUT: longest a put waits
+    atomic_uint_least64_t dropped;   // new items refused for lack of room
+    atomic_uint_least64_t evicted;   // queued items pushed out for new ones
+    atomic_uint_least64_t timeouts;  // puts that stopped waiting at the deadline
+
+    uint64_t spin_ns;             // consumers busy-poll this long before parking
 } consumer_producer_t;
 
 int   consumer_producer_init(consumer_producer_t* q, int capacity);
+int   consumer_producer_init_backend(consumer_producer_t* q, int capacity, cp_backend_t backend);
 void  consumer_producer_destroy(consumer_producer_t* q);
 
+// message api: put moves the message in (the queue owns it on success, the
+// caller keeps it on failure); get moves one out, -1 once finished and drained.
+// batch variants move many items per lock round-trip (spsc: per index publish).
+// put_batch blocks until all n are in and returns how many were queued (< n
+// only if the queue finished); get_batch blocks for at least one item, then
+// takes whatever is ready up to max; 0 means finished and drained.
+int   consumer_producer_put_msg(consumer_producer_t* q, msg_t* m);
+int   consumer_producer_get_msg(consumer_producer_t* q, msg_t* out);
+int   consumer_producer_put_msg_batch(consumer_producer_t* q, msg_t* items, int n);
+int   consumer_producer_get_msg_batch(consumer_producer_t* q, msg_t* out, int max);
+// as get_msg_batch, and reports the dequeue ticket of out[0]; the items carry
+// consecutive tickets in queue order, so several consumers can restore it
+int   consumer_producer_get_msg_batch_seq(consumer_producer_t* q, msg_t* out, int max, uint64_t* first_seq);
+
+// bounded waits: 0 done, 1 timed out (put: the caller keeps m), -1 once
+// finished (get: and drained). they wait regardless of the overflow policy
+int   consumer_producer_put_msg_timed(consumer_producer_t* q, msg_t* m, int timeout_ms);
+int   consumer_producer_get_msg_timed(consumer_producer_t* q, msg_t* out, int timeout_ms);
+
+// choose what puts do on a full queue; call before the queue is used.
+// items a policy drops count as placed (the queue released them), so the
+// put contracts above hold. the <END> sentinel is never dropped: it waits
+// for room. -1 for drop-oldest on the spsc ring, whose consumer alone
+// may move the read index
+int   consumer_producer_set_overflow(consumer_producer_t* q, cp_overflow_t policy, int timeout_ms);
+
+// low-latency consumers: a get on an empty queue busy-polls for up to
+// spin_ns before it parks (the spsc ring polls its write index, the locked
+// queue its not_empty monitor). burns a cpu per waiting consumer; meant for
+// threads pinned to cores of their own. call before the queue is used
+void  consumer_producer_set_spin(consumer_producer_t* q, uint64_t spin_ns);
+
+// string api, kept as shims over the message api
 int   consumer_producer_put(consumer_producer_t* q, const char* item);
+// takes ownership of a heap string on success; on failure the caller keeps it
+int   consumer_producer_put_owned(consumer_producer_t* q, char* item);
 char* consumer_producer_get(consumer_producer_t* q);
+// same contracts as the message batches, for heap strings
+int   consumer_producer_put_batch(consumer_producer_t* q, char** items, int n);
+int   consumer_producer_get_batch(consumer_producer_t* q, char** out, int max);
+
+// start keeping counters; call before the queue is used. disabled, the hot
+// path pays one predictable branch per batch
+void  consumer_producer_enable_stats(consumer_producer_t* q);
+void  consumer_producer_read_stats(const consumer_producer_t* q, cp_stats_snapshot_t* out);
 
 void  consumer_producer_signal_finished(consumer_producer_t* q);
 int   consumer_producer_wait_finished(consumer_producer_t* q);
 
-#endif // CONSUMER_PRODUCER_H
\ No newline at end of file
+#endif // CONSUMER_PRODUCER_H
@@ -0,0 +1,81 @@
+#include "lat_hist.h"
+
+#define LAT_SUB_COUNT (1u << LAT_SUB_BITS)
+
+// exact below LAT_SUB_COUNT; above, the top LAT_SUB_BITS bits after the
+// leading one pick the step within its power of two
+static unsigned bucket_of(uint64_t v) {
+    if (v < LAT_SUB_COUNT) return (unsigned)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);
+    unsigned sub = (unsigned)(v >> (e - LAT_SUB_BITS)) & (LAT_SUB_COUNT - 1);
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + sub;
+}
+
+// highest value that lands in bucket b
+static uint64_t bucket_top(unsigned b) {
+    if (b < LAT_SUB_COUNT) return b;
+    unsigned e = (b >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    uint64_t sub = b & (LAT_SUB_COUNT - 1);
+    uint64_t step = (uint64_t)1 << (e - LAT_SUB_BITS);
+    return ((LAT_SUB_COUNT + sub) << (e - LAT_SUB_BITS)) + step - 1;
+}
+
+void lat_hist_init(lat_hist_t* h) {
+    atomic_init(&h->count, 0);
+    atomic_init(&h->sum_ns, 0);
+    for (unsigned b = 0; b < LAT_BUCKETS; ++b) atomic_init(&h->buckets[b], 0);
+}
+
+void lat_hist_record(lat_hist_t* h, uint64_t ns) {
+    atomic_fetch_add_explicit(&h->buckets[bucket_of(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+}
+
+void lat_hist_copy(lat_hist_t* dst, const lat_hist_t* src) {
+    uint64_t count = 0;
+    for (unsigned b = 0; b < LAT_BUCKETS; ++b) {
+        uint64_t c = atomic_load_explicit(&src->buckets[b], memory_order_relaxed);
+        atomic_init(&dst->buckets[b], c);
+        count += c;
+    }
+    // count from the buckets themselves, so percentiles add up
+    atomic_init(&dst->count, count);
+    atomic_init(&dst->sum_ns, atomic_load_explicit(&src->sum_ns, memory_order_relaxed));
+}
+
+void lat_hist_merge(lat_hist_t* dst, const lat_hist_t* src) {
+    uint64_t count = 0;
+    for (unsigned b = 0; b < LAT_BUCKETS; ++b) {
+        uint64_t c = atomic_load_explicit(&src->buckets[b], memory_order_relaxed);
+        atomic_fetch_add_explicit(&dst->buckets[b], c, memory_order_relaxed);
+        count += c;
+    }
+    atomic_fetch_add_explicit(&dst->count, count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->sum_ns, atomic_load_explicit(&src->sum_ns, memory_order_relaxed),
+                              memory_order_relaxed);
+}
+
+uint64_t lat_hist_count(const lat_hist_t* h) {
+    return atomic_load_explicit(&h->count, memory_order_relaxed);
+}
+
+uint64_t lat_hist_mean(const lat_hist_t* h) {
+    uint64_t n = lat_hist_count(h);
+    return n ? atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / n : 0;
+}
+
+uint64_t lat_hist_percentile(const lat_hist_t* h, double p) {
+    uint64_t n = lat_hist_count(h);
+    if (n == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)n + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > n) rank = n;
+
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < LAT_BUCKETS; ++b) {
+        seen += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        if (seen >= rank) return bucket_top(b);
+    }
+    return bucket_top(LAT_BUCKETS - 1);
+}
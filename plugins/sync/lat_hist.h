@@ -0,0 +1,31 @@
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define LAT_SUB_BITS 4            // 16 linear steps per power of two: ~6% resolution
+#define LAT_BUCKETS  ((64 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+// log-bucketed latency histogram in the style of HdrHistogram: values below
+// 2^LAT_SUB_BITS get exact buckets, every power of two above is split into
+// the same number of linear steps, so any ns value fits with bounded
+// relative error. recording is one relaxed add per counter, from any thread
+typedef struct {
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t sum_ns;
+    atomic_uint_least64_t buckets[LAT_BUCKETS];
+} lat_hist_t;
+
+void     lat_hist_init(lat_hist_t* h);
+void     lat_hist_record(lat_hist_t* h, uint64_t ns);
+// copy a histogram that may still be recording
+void     lat_hist_copy(lat_hist_t* dst, const lat_hist_t* src);
+// add src's samples to dst (per-thread histograms summed for a report)
+void     lat_hist_merge(lat_hist_t* dst, const lat_hist_t* src);
+uint64_t lat_hist_count(const lat_hist_t* h);
+uint64_t lat_hist_mean(const lat_hist_t* h);
+// highest value of the bucket holding the p-th percentile (0 < p <= 100)
+uint64_t lat_hist_percentile(const lat_hist_t* h, double p);
+
+#endif // LAT_HIST_H
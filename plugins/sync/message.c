@@ -0,0 +1,183 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "message.h"
+#include "msg_pool.h"
+
+static const char k_end[] = "<END>";
+
+// pool new payloads come from; NULL means malloc
+static msg_pool_t* g_pool;
+
+// holder count of a shared payload; the payload keeps its own flags
+struct msg_ref {
+    atomic_uint refs;
+    int         pooled;           // this record is a pool block
+};
+
+static struct msg_ref* ref_alloc(void) {
+    size_t cap;
+    struct msg_ref* r = g_pool ? (struct msg_ref*)msg_pool_alloc(g_pool, sizeof(*r), &cap) : NULL;
+    int pooled = r != NULL;
+    if (!r) r = (struct msg_ref*)malloc(sizeof(*r));
+    if (!r) return NULL;
+    atomic_init(&r->refs, 1);
+    r->pooled = pooled;
+    return r;
+}
+
+static void ref_free(struct msg_ref* r) {
+    if (r->pooled) msg_pool_free(r);
+    else free(r);
+}
+
+void msg_use_pool(msg_pool_t* pool) {
+    g_pool = pool;
+}
+
+void msg_detect_end(msg_t* m) {
+    if (m && m->data && m->len == sizeof(k_end) - 1 && memcmp(m->data, k_end, m->len) == 0) {
+        m->flags |= MSG_F_END;
+    }
+}
+
+int msg_alloc(msg_t* m, size_t len) {
+    if (!m) return -1;
+    size_t cap = 0;
+    m->data = g_pool ? (char*)msg_pool_alloc(g_pool, len + 1, &cap) : NULL;
+    m->flags = m->data ? MSG_F_POOLED : 0;
+    if (!m->data) {
+        // no pool, or the line is larger than its biggest class
+        m->data = (char*)malloc(len + 1);
+        cap = len + 1;
+    }
+    if (!m->data) {
+        m->len = m->cap = 0;
+        m->flags = 0;
+        return -1;
+    }
+    m->data[len] = '\0';
+    m->len = len;
+    m->cap = cap;
+    m->t_ingest = m->t_hop = 0;
+    m->ref = NULL;
+    return 0;
+}
+
+int msg_from_bytes(msg_t* m, const char* bytes, size_t len) {
+    if (!bytes || msg_alloc(m, len) != 0) return -1;
+    memcpy(m->data, bytes, len);
+    return 0;
+}
+
+int msg_from_cstr(msg_t* m, const char* s) {
+    if (!s || msg_from_bytes(m, s, strlen(s)) != 0) return -1;
+    msg_detect_end(m);
+    return 0;
+}
+
+void msg_adopt_cstr(msg_t* m, char* s) {
+    if (!m) return;
+    m->data = s;
+    m->len = s ? strlen(s) : 0;
+    m->cap = s ? m->len + 1 : 0;
+    m->flags = 0;
+    m->t_ingest = m->t_hop = 0;
+    m->ref = NULL;
+    if (s) msg_detect_end(m);
+}
+
+void msg_borrow(msg_t* m, const char* bytes, size_t len) {
+    if (!m) return;
+    m->data = (char*)bytes;
+    m->len = len;
+    m->cap = 0;
+    m->flags = MSG_F_BORROWED;
+    m->t_ingest = m->t_hop = 0;
+    m->ref = NULL;
+}
+
+int msg_writable(const msg_t* m) {
+    if (!m || (m->flags & MSG_F_BORROWED)) return 0;
+    // a count of 1 is this holder alone, and only holders can raise it
+    return !(m->flags & MSG_F_SHARED) ||
+           atomic_load_explicit(&m->ref->refs, memory_order_acquire) == 1;
+}
+
+int msg_own(msg_t* m) {
+    if (!m || !(m->flags & (MSG_F_BORROWED | MSG_F_SHARED))) return 0;
+    if (msg_writable(m)) {
+        // the last holder takes the payload back as it is
+        ref_free(m->ref);
+        m->ref = NULL;
+        m->flags &= ~MSG_F_SHARED;
+        return 0;
+    }
+    msg_t copy;
+    if (msg_from_bytes(&copy, m->data, m->len) != 0) return -1;
+    copy.flags |= m->flags & MSG_F_END;
+    msg_copy_times(&copy, m);
+    msg_release(m);
+    *m = copy;
+    return 0;
+}
+
+int msg_share(msg_t* dst, msg_t* src) {
+    if (!dst || !src || !src->data) return -1;
+    // a borrowed view needs no count: the bytes outlive every holder
+    if (!(src->flags & (MSG_F_BORROWED | MSG_F_SHARED))) {
+        src->ref = ref_alloc();
+        if (!src->ref) return -1;
+        src->flags |= MSG_F_SHARED;
+    }
+    if (src->flags & MSG_F_SHARED) atomic_fetch_add_explicit(&src->ref->refs, 1, memory_order_relaxed);
+    *dst = *src;
+    return 0;
+}
+
+int msg_end(msg_t* m) {
+    if (msg_from_bytes(m, k_end, sizeof(k_end) - 1) != 0) return -1;
+    m->flags |= MSG_F_END;
+    return 0;
+}
+
+void msg_release(msg_t* m) {
+    if (!m) return;
+    // a shared payload stays until its last holder lets go; acq_rel orders
+    // every holder's reads before the free
+    int last = 1;
+    if (m->flags & MSG_F_SHARED) {
+        last = atomic_fetch_sub_explicit(&m->ref->refs, 1, memory_order_acq_rel) == 1;
+        if (last) ref_free(m->ref);
+    }
+    if (!last || (m->flags & MSG_F_BORROWED)) {
+        // not this holder's to free
+    } else if (m->flags & MSG_F_POOLED) {
+        msg_pool_free(m->data);
+    } else {
+        free(m->data);
+    }
+    m->data = NULL;
+    m->len = m->cap = 0;
+    m->flags = 0;
+    m->t_ingest = m->t_hop = 0;
+    m->ref = NULL;
+}
+
+char* msg_take_cstr(msg_t* m) {
+    if (!m || !m->data) return NULL;
+    char* s = m->data;
+    if (m->flags & (MSG_F_POOLED | MSG_F_BORROWED | MSG_F_SHARED)) {
+        s = (char*)malloc(m->len + 1);
+        if (s) {
+            memcpy(s, m->data, m->len);
+            s[m->len] = '\0';
+        }
+        msg_release(m);
+        return s;
+    }
+    m->data = NULL;
+    m->len = m->cap = 0;
+    m->flags = 0;
+    return s;
+}
@@ -0,0 +1,75 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// message flags
+#define MSG_F_END    0x1u         // end-of-stream sentinel
+#define MSG_F_POOLED 0x2u         // data is a msg_pool block, not malloc'd
+#define MSG_F_BORROWED 0x4u       // data is a read-only view owned elsewhere
+#define MSG_F_SHARED 0x8u         // data is counted and read-only, see msg_share
+
+struct msg_pool;
+struct msg_ref;
+
+// one record flowing through the pipeline; the holder owns data.
+// data is NUL-terminated (data[len] == '\0') so the const char* shims can
+// hand it out as-is, but len is authoritative: payloads may contain
+// embedded NULs. a borrowed message is the exception: a read-only view
+// (e.g. into a mapped input file) that is neither terminated nor owned;
+// msg_own turns it into a normal one before anything writes to it. a
+// shared message is one of several holders of one payload: each holder
+// releases its own message, the last one frees the payload.
+typedef struct {
+    char*    data;                // heap payload (pool block or malloc)
+    size_t   len;                 // payload bytes
+    size_t   cap;                 // allocated bytes, >= len + 1
+    unsigned flags;               // MSG_F_*
+    uint64_t t_ingest;            // monotonic ns the line was read, 0 = not timed
+    uint64_t t_hop;               // monotonic ns it was handed to its current stage
+    struct msg_ref* ref;          // holder count of a shared payload, else NULL
+} msg_t;
+
+// allocate messages from pool from now on (NULL: plain malloc). set once per
+// loaded image before its threads allocate; frees never need it
+void msg_use_pool(struct msg_pool* pool);
+// allocate room for len payload bytes; caller fills data[0..len)
+int  msg_alloc(msg_t* m, size_t len);
+// copy len bytes into a fresh message
+int  msg_from_bytes(msg_t* m, const char* bytes, size_t len);
+// copy a C string; the "<END>" sentinel becomes an END message
+int  msg_from_cstr(msg_t* m, const char* s);
+// wrap a heap C string without copying; "<END>" becomes an END message
+void msg_adopt_cstr(msg_t* m, char* s);
+// wrap len bytes owned by someone else that outlive the message
+void msg_borrow(msg_t* m, const char* bytes, size_t len);
+// make the payload the caller's to write: a borrowed view, or a payload
+// other holders still share, is copied first; no-op otherwise
+int  msg_own(msg_t* m);
+// whether the holder may write the payload in place without msg_own copying
+int  msg_writable(const msg_t* m);
+// make dst one more holder of src's payload, flags and times without
+// copying bytes (a broadcast). both turn read-only until msg_own; src may
+// already be shared or borrowed. safe while other threads hold the payload
+int  msg_share(msg_t* dst, msg_t* src);
+// flag the "<END>" sentinel once, where text enters the pipeline
+void msg_detect_end(msg_t* m);
+// build an END message
+int  msg_end(msg_t* m);
+// carry the timestamps of the message a result was made from
+static inline void msg_copy_times(msg_t* dst, const msg_t* src) {
+    dst->t_ingest = src->t_ingest;
+    dst->t_hop = src->t_hop;
+}
+// free the payload and clear the message
+void msg_release(msg_t* m);
+// turn the message into a malloc'd C string the caller frees (pool blocks,
+// borrowed views and shared payloads are copied out); the message is left empty. NULL on allocation failure
+char* msg_take_cstr(msg_t* m);
+
+static inline int msg_is_end(const msg_t* m) {
+    return (m->flags & MSG_F_END) != 0;
+}
+
+#endif // MESSAGE_H
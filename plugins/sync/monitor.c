@@ -1,23 +1,69 @@
 #include "monitor.h"
 #include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static long futex(atomic_uint* word, int op, unsigned val, const struct timespec* rel) {
+    return syscall(SYS_futex, word, op, val, rel, NULL, 0);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
 
 int monitor_init(monitor_t* m) {
     if (!m) return -1;
-    if (pthread_cond_init(&m->condition, NULL) != 0) return -1;
+    atomic_init(&m->seq, 0);
+    m->waiters = 0;
+    m->woken = 0;
     m->signaled = 0;
+    m->spin_max = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? MONITOR_SPIN_MAX : 0;
+    m->spin = m->spin_max / 8;
+    m->poll_ns = 0;
     return 0;
 }
 
+void monitor_set_poll(monitor_t* m, uint64_t poll_ns) {
+    if (m) m->poll_ns = poll_ns;
+}
+
+// poll seq until it moves or poll_ns passed; the clock is read every 64 polls
+static int poll_for_change(monitor_t* m, unsigned seen) {
+    uint64_t until = now_ns() + m->poll_ns;
+    for (unsigned i = 1;; ++i) {
+        if (atomic_load_explicit(&m->seq, memory_order_acquire) != seen) return 1;
+        cpu_relax();
+        if ((i & 63) == 0 && now_ns() >= until) return 0;
+    }
+}
+
 void monitor_destroy(monitor_t* m) {
     if (!m) return;
-    pthread_cond_destroy(&m->condition);
+    // waiters are gone by now; nothing is held in the kernel
+    m->waiters = m->woken = 0;
 }
 
-// caller holds external_mutex when calling this
+// caller holds external_mutex when calling this.
+// the counters only change under the mutex, so reading them here is exact
 void monitor_signal_locked(monitor_t* m, pthread_mutex_t* external_mutex) {
     if (!m || !external_mutex) return;
     m->signaled = 1;
-    pthread_cond_signal(&m->condition);
+    if (m->waiters == m->woken) return;
+    m->woken++;
+    atomic_fetch_add_explicit(&m->seq, 1, memory_order_release);
+    futex(&m->seq, FUTEX_WAKE_PRIVATE, 1, NULL);
 }
 
 // caller holds external_mutex when calling this
@@ -26,15 +72,68 @@ void monitor_reset_locked(monitor_t* m, pthread_mutex_t* external_mutex) {
     m->signaled = 0;
 }
 
-// waits until m->signaled becomes 1; caller holds external_mutex
-int monitor_wait_locked(monitor_t* m, pthread_mutex_t* external_mutex) {
+// a waiter is back under the mutex. it takes one sent wakeup off the count
+// even if it returned for another reason: the thread that wakeup was for
+// then counts as not woken, and the next signal wakes it again
+static void waiter_leave(monitor_t* m) {
+    m->waiters--;
+    if (m->woken > 0) m->woken--;
+}
+
+// waits until m->signaled becomes 1 or the deadline passes; caller holds
+// external_mutex. seq is read before the mutex is dropped, so a signal in
+// between changes it and the futex wait returns at once instead of missing
+// the wakeup. FUTEX_WAIT takes a relative timeout (on CLOCK_MONOTONIC)
+int monitor_timedwait_locked(monitor_t* m, pthread_mutex_t* external_mutex, uint64_t deadline_ns) {
     if (!m || !external_mutex) return -1;
     while (!m->signaled) {
-        if (pthread_cond_wait(&m->condition, external_mutex) != 0) {
-            return -1;
+        struct timespec rel;
+        if (deadline_ns) {
+            uint64_t now = now_ns();
+            if (now >= deadline_ns) return MONITOR_TIMEDOUT;
+            rel.tv_sec = (time_t)((deadline_ns - now) / 1000000000u);
+            rel.tv_nsec = (long)((deadline_ns - now) % 1000000000u);
+        }
+        unsigned seen = atomic_load_explicit(&m->seq, memory_order_acquire);
+        int budget = m->spin;
+        m->waiters++;
+        pthread_mutex_unlock(external_mutex);
+
+        int woke_spinning;
+        if (m->poll_ns) {
+            woke_spinning = poll_for_change(m, seen);
+        } else {
+            int spun = 0;
+            while (spun < budget && atomic_load_explicit(&m->seq, memory_order_acquire) == seen) {
+                cpu_relax();
+                spun++;
+            }
+            woke_spinning = spun < budget;
+        }
+        if (!woke_spinning) {
+            long rc = futex(&m->seq, FUTEX_WAIT_PRIVATE, seen, deadline_ns ? &rel : NULL);
+            if (rc != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+                pthread_mutex_lock(external_mutex);
+                waiter_leave(m);
+                return -1;
+            }
+        }
+
+        pthread_mutex_lock(external_mutex);
+        waiter_leave(m);
+        // poll longer after a wakeup that came while polling, less after one
+        // that needed the kernel
+        if (woke_spinning) {
+            m->spin = m->spin * 2 + 16 < m->spin_max ? m->spin * 2 + 16 : m->spin_max;
+        } else {
+            m->spin /= 2;
         }
     }
     // reset after a successful wait to keep semantics sticky-but-one-shot
     m->signaled = 0;
     return 0;
-}
\ No newline at end of file
+}
+
+int monitor_wait_locked(monitor_t* m, pthread_mutex_t* external_mutex) {
+    return monitor_timedwait_locked(m, external_mutex, 0);
+}
@@ -2,22 +2,44 @@
 #define MONITOR_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <time.h>
 
-// sticky monitor state; caller holds an external mutex
+#define MONITOR_SPIN_MAX 2048     // most polls of the futex word before sleeping
+#define MONITOR_TIMEDOUT 1        // monitor_timedwait_locked: deadline passed first
+
+// sticky monitor state; caller holds an external mutex.
+// an eventcount on a raw futex: a signal bumps seq and wakes one sleeper
+// only while some waiter has no wakeup on its way yet. otherwise it just
+// sets the sticky flag, so neither an idle monitor nor a burst of signals
+// before the woken thread runs costs a syscall. a waiter polls seq for a
+// short, self-tuning while before it sleeps in the kernel
 typedef struct {
-    pthread_cond_t condition;   // condition variable
-    int            signaled;    // sticky flag to avoid lost signals
+    atomic_uint seq;            // futex word: bumped by each signal that wakes
+    int         waiters;        // threads inside monitor_wait_locked
+    int         woken;          // of those, how many a wakeup is already sent to
+    int         signaled;       // sticky flag to avoid lost signals
+    int         spin;           // current poll budget, adapted per wait
+    int         spin_max;       // 0 on a single cpu: polling cannot pay off
+    uint64_t    poll_ns;        // if set, poll this long before every sleep instead
 } monitor_t;
 
 int  monitor_init(monitor_t* m);
 void monitor_destroy(monitor_t* m);
 
+// busy-poll for poll_ns before each sleep, on any cpu count, instead of the
+// adaptive budget; 0 goes back to it. call before the monitor is used
+void monitor_set_poll(monitor_t* m, uint64_t poll_ns);
+
 // caller must hold external_mutex while calling these
 void monitor_signal_locked(monitor_t* m, pthread_mutex_t* external_mutex);
 void monitor_reset_locked(monitor_t* m, pthread_mutex_t* external_mutex);
 
 // waits until signaled; caller must hold external_mutex on entry
 int  monitor_wait_locked(monitor_t* m, pthread_mutex_t* external_mutex);
+// as monitor_wait_locked, but gives up at deadline_ns (CLOCK_MONOTONIC;
+// 0 waits without limit): 0 signaled, MONITOR_TIMEDOUT, -1 on error
+int  monitor_timedwait_locked(monitor_t* m, pthread_mutex_t* external_mutex, uint64_t deadline_ns);
 
-#endif // MONITOR_H
\ No newline at end of file
+#endif // MONITOR_H
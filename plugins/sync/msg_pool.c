@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include "msg_pool.h"
+
+#define MSG_POOL_SLAB_BYTES (256u << 10)   // slab size cap for the large classes
+
+// header in front of every payload
+typedef struct msg_block {
+    msg_pool_t* pool;             // owner, set when the slab is carved
+    size_t cls;                   // size class index
+    struct msg_block* next;       // free-list link, used only while free
+    size_t pad;                   // keeps the payload 16-byte aligned
+} msg_block_t;
+
+// per-thread cache; one per loaded image, which is fine: a thread allocates
+// through the image it runs in and frees into whichever cache it has
+typedef struct {
+    msg_pool_t* pool;
+    msg_block_t* head[MSG_POOL_CLASSES];
+    unsigned count[MSG_POOL_CLASSES];
+} tcache_t;
+
+static __thread tcache_t t_cache;
+
+static inline size_t class_payload(size_t cls) {
+    return (size_t)1 << (cls + MSG_POOL_MIN_SHIFT);
+}
+
+// smallest class that fits size, -1 if none does
+static int class_of(size_t size) {
+    for (int c = 0; c < MSG_POOL_CLASSES; ++c) {
+        if (size <= class_payload((size_t)c)) return c;
+    }
+    return -1;
+}
+
+static int remember_chunk(msg_pool_t* pool, void* chunk) {
+    pthread_mutex_lock(&pool->chunk_lock);
+    if (pool->n_chunks == pool->cap_chunks) {
+        size_t cap = pool->cap_chunks ? pool->cap_chunks * 2 : 64;
+        void** grown = (void**)realloc(pool->chunks, cap * sizeof(void*));
+        if (!grown) {
+            pthread_mutex_unlock(&pool->chunk_lock);
+            return -1;
+        }
+        pool->chunks = grown;
+        pool->cap_chunks = cap;
+    }
+    pool->chunks[pool->n_chunks++] = chunk;
+    pthread_mutex_unlock(&pool->chunk_lock);
+    return 0;
+}
+
+// carve a fresh slab of class c into a linked run; returns its length
+static size_t carve_slab(msg_pool_t* pool, size_t c, msg_block_t** first, msg_block_t** last) {
+    size_t block = sizeof(msg_block_t) + class_payload(c);
+    size_t n = MSG_POOL_SLAB_BYTES / block;
+    if (n > MSG_POOL_BATCH) n = MSG_POOL_BATCH;
+    if (n == 0) n = 1;
+
+    char* chunk = (char*)malloc(n * block);
+    if (!chunk) return 0;
+    if (remember_chunk(pool, chunk) != 0) {
+        free(chunk);
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        msg_block_t* b = (msg_block_t*)(chunk + i * block);
+        b->pool = pool;
+        b->cls = c;
+        b->next = (i + 1 < n) ? (msg_block_t*)(chunk + (i + 1) * block) : NULL;
+    }
+    *first = (msg_block_t*)chunk;
+    *last = (msg_block_t*)(chunk + (n - 1) * block);
+    return n;
+}
+
+static void push_shared(msg_pool_t* pool, size_t c, msg_block_t* first, msg_block_t* last, size_t n) {
+    pthread_mutex_lock(&pool->cls[c].lock);
+    last->next = pool->cls[c].free;
+    pool->cls[c].free = first;
+    pool->cls[c].count += n;
+    pthread_mutex_unlock(&pool->cls[c].lock);
+}
+
+// fill an empty thread cache: a batch from the shared list, else a new slab
+static void refill(msg_pool_t* pool, tcache_t* tc, size_t c) {
+    pthread_mutex_lock(&pool->cls[c].lock);
+    msg_block_t* first = pool->cls[c].free;
+    msg_block_t* last = first;
+    size_t n = 0;
+    if (first) {
+        n = 1;
+        while (n < MSG_POOL_BATCH && last->next) {
+            last = last->next;
+            n++;
+        }
+        pool->cls[c].free = last->next;
+        pool->cls[c].count -= n;
+    }
+    pthread_mutex_unlock(&pool->cls[c].lock);
+
+    if (n == 0) n = carve_slab(pool, c, &first, &last);
+    if (n == 0) return;
+    last->next = NULL;
+    tc->head[c] = first;
+    tc->count[c] = (unsigned)n;
+}
+
+msg_pool_t* msg_pool_create(void) {
+    msg_pool_t* pool = (msg_pool_t*)calloc(1, sizeof(msg_pool_t));
+    if (!pool) return NULL;
+    for (int c = 0; c < MSG_POOL_CLASSES; ++c) {
+        pthread_mutex_init(&pool->cls[c].lock, NULL);
+    }
+    pthread_mutex_init(&pool->chunk_lock, NULL);
+    return pool;
+}
+
+void msg_pool_destroy(msg_pool_t* pool) {
+    if (!pool) return;
+    // the calling thread's cache points into the slabs below
+    if (t_cache.pool == pool) memset(&t_cache, 0, sizeof(t_cache));
+
+    for (size_t i = 0; i < pool->n_chunks; ++i) free(pool->chunks[i]);
+    free(pool->chunks);
+    for (int c = 0; c < MSG_POOL_CLASSES; ++c) {
+        pthread_mutex_destroy(&pool->cls[c].lock);
+    }
+    pthread_mutex_destroy(&pool->chunk_lock);
+    free(pool);
+}
+
+int msg_pool_prefill(msg_pool_t* pool, size_t size, size_t count) {
+    int c = class_of(size);
+    if (!pool || c < 0) return -1;
+    while (count > 0) {
+        msg_block_t* first;
+        msg_block_t* last;
+        size_t n = carve_slab(pool, (size_t)c, &first, &last);
+        if (n == 0) return -1;
+        push_shared(pool, (size_t)c, first, last, n);
+        count = n < count ? count - n : 0;
+    }
+    return 0;
+}
+
+void* msg_pool_alloc(msg_pool_t* pool, size_t size, size_t* cap) {
+    int c = class_of(size);
+    if (!pool || c < 0) return NULL;
+
+    tcache_t* tc = &t_cache;
+    if (tc->pool != pool) {
+        msg_pool_thread_flush();
+        tc->pool = pool;
+    }
+    if (!tc->head[c]) refill(pool, tc, (size_t)c);
+    msg_block_t* b = tc->head[c];
+    if (!b) return NULL;
+
+    tc->head[c] = b->next;
+    tc->count[c]--;
+    if (cap) *cap = class_payload((size_t)c);
+    return b + 1;
+}
+
+void msg_pool_free(void* p) {
+    if (!p) return;
+    msg_block_t* b = (msg_block_t*)p - 1;
+    msg_pool_t* pool = b->pool;
+    size_t c = b->cls;
+
+    tcache_t* tc = &t_cache;
+    if (!tc->pool) tc->pool = pool;
+    if (tc->pool != pool) {
+        // a thread working for another pool: straight to the shared list
+        push_shared(pool, c, b, b, 1);
+        return;
+    }
+
+    b->next = tc->head[c];
+    tc->head[c] = b;
+    if (++tc->count[c] <= MSG_POOL_CACHE_MAX) return;
+
+    // over the cap: return a batch so the allocating thread can reuse it
+    msg_block_t* last = b;
+    for (unsigned i = 1; i < MSG_POOL_BATCH; ++i) last = last->next;
+    tc->head[c] = last->next;
+    tc->count[c] -= MSG_POOL_BATCH;
+    push_shared(pool, c, b, last, MSG_POOL_BATCH);
+}
+
+void msg_pool_thread_flush(void) {
+    tcache_t* tc = &t_cache;
+    if (tc->pool) {
+        for (size_t c = 0; c < MSG_POOL_CLASSES; ++c) {
+            msg_block_t* first = tc->head[c];
+            if (!first) continue;
+            msg_block_t* last = first;
+            while (last->next) last = last->next;
+            push_shared(tc->pool, c, first, last, tc->count[c]);
+        }
+    }
+    memset(tc, 0, sizeof(*tc));
+}
@@ -0,0 +1,46 @@
+#ifndef MSG_POOL_H
+#define MSG_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define MSG_POOL_MIN_SHIFT 5      // smallest block: 32 bytes
+#define MSG_POOL_CLASSES   12     // 32 B .. 64 KiB blocks, powers of two
+#define MSG_POOL_CACHE_MAX 64     // blocks a thread keeps per class
+#define MSG_POOL_BATCH     32     // blocks moved per trip to the shared list
+
+struct msg_block;
+
+// size-classed block pool shared by every stage of a pipeline. each thread
+// keeps a small cache per class; blocks freed on another thread than the one
+// that allocated them land in that thread's cache and flow back in batches
+// through the per-class shared list. blocks carry their pool, so any copy of
+// this code (host or plugin) can free them.
+typedef struct msg_pool {
+    struct {
+        pthread_mutex_t lock;
+        struct msg_block* free;   // shared list of free blocks
+        size_t count;
+    } cls[MSG_POOL_CLASSES];
+
+    pthread_mutex_t chunk_lock;   // guards the slab list
+    void** chunks;                // every slab, released by destroy
+    size_t n_chunks;
+    size_t cap_chunks;
+} msg_pool_t;
+
+msg_pool_t* msg_pool_create(void);
+// releases all slabs; every block must be back (threads flushed or gone)
+void  msg_pool_destroy(msg_pool_t* pool);
+// make count blocks of at least size bytes ready up front; 0 on success
+int   msg_pool_prefill(msg_pool_t* pool, size_t size, size_t count);
+
+// a block of at least size bytes, its usable size in *cap; NULL when size
+// is above the largest class or memory ran out (fall back to malloc)
+void* msg_pool_alloc(msg_pool_t* pool, size_t size, size_t* cap);
+// give a block back to its pool, from any thread
+void  msg_pool_free(void* p);
+// hand this thread's cached blocks back to the shared lists (thread exit)
+void  msg_pool_thread_flush(void);
+
+#endif // MSG_POOL_H
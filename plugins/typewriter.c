@@ -1,45 +1,223 @@
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
 #include "plugin_common.h"
 
-// returns per-char delay in ms, 0 means no delay 
-static unsigned tw_delay_ms(void) {
-    unsigned delay_ms = 100; /* default 100ms */
+#define TW_BUFFER_DEFAULT 4096    /* bytes of text waiting to be typed */
+
+// the line is forwarded at once; a display thread types it out from a
+// bounded buffer at the configured pace. a line that does not fit is dropped
+// (counted and reported) and the backlog ahead of it is printed in one go so
+// the display catches up. TYPEWRITER_ASYNC=0, or a 0 ms delay, types inline;
+// so does a line larger than the whole buffer, and every line if the
+// display thread cannot start
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;          /* text arrived, or shutting down */
+    pthread_cond_t idle;          /* everything queued has been shown */
+    char* buf;                    /* ring of '\n'-terminated lines */
+    size_t cap;
+    size_t head;
+    size_t len;
+    uint64_t queued;              /* bytes ever queued */
+    uint64_t shown;               /* bytes ever shown */
+    uint64_t drop_mark;           /* queued count when the first drop happened */
+    unsigned long dropped;        /* lines dropped since the last report */
+    int hurry;                    /* show the backlog without delay */
+    unsigned delay_ms;
+    pthread_t display;
+    int display_up;
+    int stop;
+} g_tw = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER,
+           .idle = PTHREAD_COND_INITIALIZER, .delay_ms = 100 };
+
+// read the settings once; per-char delay in ms, 0 means no delay
+static void tw_configure(void) {
     const char* env = getenv("FAST_TYPEWRITER");
     if (env && *env) {
         char* endp = NULL;
         unsigned long v = strtoul(env, &endp, 10);
-        delay_ms = (endp && *endp == '\0') ? (unsigned)v : 0;
+        g_tw.delay_ms = (endp && *endp == '\0') ? (unsigned)v : 0;
     }
-    return delay_ms;
+
+    env = getenv("TYPEWRITER_ASYNC");
+    if (g_tw.delay_ms == 0 || g_tw.buf || (env && strcmp(env, "0") == 0)) return;
+
+    size_t cap = TW_BUFFER_DEFAULT;
+    env = getenv("TYPEWRITER_BUFFER");
+    if (env && *env) cap = strtoul(env, NULL, 10);
+    if (cap == 0) return;
+
+    g_tw.buf = (char*)malloc(cap);
+    if (g_tw.buf) g_tw.cap = cap;
 }
 
-static const char* tw_transform(const char* text) {
-    if (!text) return NULL;
-    
-    if (strcmp(text, "<END>") == 0) {
-        return strdup("<END>");
-        } 
+// copy n bytes starting at ring offset `at` out of the ring
+static void ring_read(char* dst, size_t at, size_t n) {
+    size_t first = g_tw.cap - at < n ? g_tw.cap - at : n;
+    memcpy(dst, g_tw.buf + at, first);
+    memcpy(dst + first, g_tw.buf, n - first);
+}
+
+static void ring_write(size_t at, const char* src, size_t n) {
+    size_t first = g_tw.cap - at < n ? g_tw.cap - at : n;
+    memcpy(g_tw.buf + at, src, first);
+    memcpy(g_tw.buf, src + first, n - first);
+}
 
-    unsigned delay_ms = tw_delay_ms();
+// length of the line at the head of the ring, '\n' included
+static size_t head_line_len(void) {
+    for (size_t i = 0; i < g_tw.len; ++i) {
+        if (g_tw.buf[(g_tw.head + i) % g_tw.cap] == '\n') return i + 1;
+    }
+    return g_tw.len;
+}
 
-    // print as one unit to avoid interleaving with other threads 
+// type one line: pause for each character as the typist would, then print
+// the line whole. the ring bytes stay reserved until we give them back, so
+// they can be read without the lock. stdout is locked only for the write,
+// so stages printing after the typewriter never wait on the pauses and no
+// line is printed into the middle of another
+static void type_line(size_t at, size_t n) {
+    char chunk[256];
+    for (size_t i = 1; i < n && !__atomic_load_n(&g_tw.hurry, __ATOMIC_RELAXED); ++i) {
+        usleep(g_tw.delay_ms * 1000);
+    }
+    flockfile(stdout);
+    fputs("[typewriter] ", stdout);
+    while (n > 0) {
+        size_t k = n < sizeof(chunk) ? n : sizeof(chunk);
+        ring_read(chunk, at, k);
+        fwrite(chunk, 1, k, stdout);
+        at = (at + k) % g_tw.cap;
+        n -= k;
+    }
+    fflush(stdout);
+    funlockfile(stdout);
+}
+
+static void* display_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_tw.lock);
+    for (;;) {
+        if (g_tw.dropped && g_tw.shown >= g_tw.drop_mark) {
+            // caught up with the point of the first drop: report, slow down
+            unsigned long dropped = g_tw.dropped;
+            g_tw.dropped = 0;
+            __atomic_store_n(&g_tw.hurry, 0, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&g_tw.lock);
+            flockfile(stdout);
+            printf("[typewriter] (%lu line%s skipped)\n", dropped, dropped == 1 ? "" : "s");
+            fflush(stdout);
+            funlockfile(stdout);
+            pthread_mutex_lock(&g_tw.lock);
+            continue;
+        }
+        if (g_tw.len == 0) {
+            pthread_cond_broadcast(&g_tw.idle);
+            if (g_tw.stop) break;
+            pthread_cond_wait(&g_tw.wake, &g_tw.lock);
+            continue;
+        }
+
+        size_t at = g_tw.head;
+        size_t n = head_line_len();
+        pthread_mutex_unlock(&g_tw.lock);
+        type_line(at, n);
+        pthread_mutex_lock(&g_tw.lock);
+
+        g_tw.head = (g_tw.head + n) % g_tw.cap;
+        g_tw.len -= n;
+        g_tw.shown += n;
+    }
+    pthread_mutex_unlock(&g_tw.lock);
+    return NULL;
+}
+
+// wait until the display has shown everything queued; lock held
+static void wait_idle_locked(void) {
+    while (g_tw.display_up && (g_tw.len > 0 || g_tw.dropped)) {
+        pthread_cond_wait(&g_tw.idle, &g_tw.lock);
+    }
+}
+
+// queue a line for display; 0 if the caller must type it inline instead.
+// only a line that would fit an empty ring is dropped for want of room: a
+// larger one waits for the display to finish, so it is typed in order
+static int tw_enqueue(const msg_t* in) {
+    pthread_mutex_lock(&g_tw.lock);
+    if (!g_tw.display_up && pthread_create(&g_tw.display, NULL, display_thread, NULL) == 0) {
+        g_tw.display_up = 1;
+    }
+    if (!g_tw.display_up || in->len + 1 > g_tw.cap) {
+        wait_idle_locked();
+        pthread_mutex_unlock(&g_tw.lock);
+        return 0;
+    }
+    if (in->len + 1 > g_tw.cap - g_tw.len) {
+        if (g_tw.dropped++ == 0) g_tw.drop_mark = g_tw.queued;
+        __atomic_store_n(&g_tw.hurry, 1, __ATOMIC_RELAXED);
+    } else {
+        size_t tail = (g_tw.head + g_tw.len) % g_tw.cap;
+        ring_write(tail, in->data, in->len);
+        ring_write((tail + in->len) % g_tw.cap, "\n", 1);
+        g_tw.len += in->len + 1;
+        g_tw.queued += in->len + 1;
+    }
+    pthread_cond_signal(&g_tw.wake);
+    pthread_mutex_unlock(&g_tw.lock);
+    return 1;
+}
+
+static int tw_transform(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
+
+    if (g_tw.cap && tw_enqueue(in)) {
+        return msg_from_bytes(out, in->data, in->len);
+    }
+
+    // print as one unit to avoid interleaving with other threads
     flockfile(stdout);
     printf("[typewriter] ");
-    for (size_t i = 0; text[i] != '\0'; ++i) {
-        putchar((unsigned char)text[i]);
-        if (delay_ms > 0) usleep(delay_ms * 1000);
+    for (size_t i = 0; i < in->len; ++i) {
+        putchar((unsigned char)in->data[i]);
+        if (g_tw.delay_ms > 0) usleep(g_tw.delay_ms * 1000);
     }
     putchar('\n');
     fflush(stdout);
     funlockfile(stdout);
 
-    // forward unchanged 
-    return strdup(text);
+    // forward unchanged
+    return msg_from_bytes(out, in->data, in->len);
+}
+
+// a worker stopped: let the display finish what it was given
+void plugin_flush(void) {
+    if (!g_tw.cap) return;
+    pthread_mutex_lock(&g_tw.lock);
+    wait_idle_locked();
+    pthread_mutex_unlock(&g_tw.lock);
+}
+
+// unload: the display drains what is left, then exits
+__attribute__((destructor))
+static void tw_unload(void) {
+    if (!g_tw.cap) return;
+    pthread_mutex_lock(&g_tw.lock);
+    g_tw.stop = 1;
+    pthread_cond_signal(&g_tw.wake);
+    pthread_mutex_unlock(&g_tw.lock);
+    if (g_tw.display_up) pthread_join(g_tw.display, NULL);
+
+    free(g_tw.buf);
+    g_tw.buf = NULL;
+    g_tw.cap = 0;
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(tw_transform, "typewriter", queue_size);
-}
\ No newline at end of file
+    tw_configure();
+    return common_plugin_init_msg(tw_transform, "typewriter", queue_size);
+}
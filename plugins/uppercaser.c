@@ -1,29 +1,28 @@
-#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "plugin_common.h"
+#include "kernels/text_kernels.h"
 
 // plugin-specific transformation logic: make a copy and uppercase it 
-const char* plugin_transform(const char* input_str) {
-    if (!input_str) return NULL;
-
-    if (strcmp(input_str, "<END>") == 0) {
-        return strdup("<END>");
-    }
+static int upper_copy(const msg_t* in, msg_t* out) {
+    if (!in || !out) return -1;
 
     // allocate a copy of the input 
-    char* result = strdup(input_str);
-    if (!result) return NULL;
+    if (msg_alloc(out, in->len) != 0) return -1;
 
     // convert each character to uppercase 
-    for (int i = 0; result[i]; ++i) {
-        result[i] = toupper((unsigned char)result[i]);
-    }
-    return result;
+    text_upper(out->data, in->data, in->len);
+    return 0;
+}
+
+// same, on a buffer the worker already owns 
+int plugin_transform_inplace(char* buf, size_t len) {
+    text_upper(buf, buf, len);
+    return 0;
 }
 
 // plugin initialization — uses shared common logic 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "uppercaser", queue_size);
-}
\ No newline at end of file
+    return common_plugin_init_pure(upper_copy, "uppercaser", queue_size);
+}
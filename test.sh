@@ -58,19 +58,11 @@ ACTUAL=$(echo -e "hi\n<END>" | $ANALYZER 10 alien logger| grep "\[logger\]" || t
 rm -f ./output/alien.so
 print_status "Test 5 PASSED"
 
-# Test 6: Duplicate plugin name in the same run -> exit code 1 + 'Multiple instances' message
-print_status "Running Test 6: Duplicate plugin name should fail with exit code 1 and message"
-set +e
-$ANALYZER 10 logger logger 1>out.tmp 2>err.tmp
-STATUS=$?
-set -e
-[ $STATUS -eq 1 ] || { cat err.tmp || true; rm -f out.tmp err.tmp; print_error "Test 6 FAILED (Expected exit 1, got $STATUS)"; }
-if ! grep -q "Multiple instances" err.tmp; then
-  cat err.tmp || true
-  rm -f out.tmp err.tmp
-  print_error "Test 6 FAILED (Missing 'Multiple instances' message in stderr)"
-fi
-rm -f out.tmp err.tmp
+# Test 6: Duplicate plugin name in the same run -> each instance runs
+print_status "Running Test 6: Duplicate plugin name runs one instance per position"
+EXPECTED=$'[logger] hi\n[logger] hi'
+ACTUAL=$(echo -e "hi\n<END>" | $ANALYZER 10 logger logger | grep "\[logger\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 6 FAILED (Expected:\n$EXPECTED\nGot:\n$ACTUAL)"
 print_status "Test 6 PASSED"
 
 # Test 7: Uppercaser + Rotator -> Logger
@@ -158,19 +150,11 @@ EXPECTED_COUNT=20
 [ "$ACTUAL_COUNT" -eq "$EXPECTED_COUNT" ] || print_error "Test 16 FAILED (Expected $EXPECTED_COUNT lines, got $ACTUAL_COUNT)"
 print_status "Test 16 PASSED"
 
-# Test 17: Duplicate plugin name (uppercaser twice) -> exit code 1 + 'Multiple instances' message
-print_status "Running Test 17: Duplicate plugin name (uppercaser twice) should fail"
-set +e
-$ANALYZER 10 uppercaser uppercaser logger 1>out.tmp 2>err.tmp
-STATUS=$?
-set -e
-[ $STATUS -eq 1 ] || { cat err.tmp || true; rm -f out.tmp err.tmp; print_error "Test 17 FAILED (Expected exit 1, got $STATUS)"; }
-if ! grep -q "Multiple instances" err.tmp; then
-  echo "STDERR:"; cat err.tmp || true
-  rm -f out.tmp err.tmp
-  print_error "Test 17 FAILED (Missing 'Multiple instances' message in stderr)"
-fi
-rm -f out.tmp err.tmp
+# Test 17: Duplicate plugin name (rotator twice) -> both instances apply
+print_status "Running Test 17: Duplicate plugin name (rotator twice) rotates twice"
+EXPECTED="[logger] LOHEL"
+ACTUAL=$(echo -e "HELLO\n<END>" | $ANALYZER 10 rotator rotator logger | grep "^\[logger\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 17 FAILED (Expected '$EXPECTED', got '$ACTUAL')"
 print_status "Test 17 PASSED"
 
 # Test 18: Complex composition expander->flipper->rotator->logger
@@ -186,5 +170,220 @@ ACTUAL=$(echo -e "hello\n<END>" | $ANALYZER 10 uppercaser typewriter | grep "^\[
 [ -z "$ACTUAL" ] || print_error "Test 19 FAILED (Expected no [logger] output, got '$ACTUAL')"
 print_status "Test 19 PASSED"
 
+# Test 20: Worker pool per stage keeps input order
+print_status "Running Test 20: uppercaser:4 flipper:3 keeps order"
+INPUT=$(printf "line%d\n" {1..2000}; echo "<END>")
+EXPECTED=$(printf "line%d\n" {1..2000} | tr 'a-z' 'A-Z' | rev | sed 's/^/[logger] /')
+ACTUAL=$(echo "$INPUT" | $ANALYZER 8 uppercaser:4 flipper:3 logger | grep "^\[logger\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 20 FAILED (output out of order or incomplete)"
+print_status "Test 20 PASSED"
+
+# Test 21: Malformed worker count -> error
+print_status "Running Test 21: Invalid worker count"
+$ANALYZER 10 uppercaser:0 logger </dev/null >/dev/null 2>&1 && print_error "Test 21 FAILED (Expected failure)"
+$ANALYZER 10 uppercaser:x logger </dev/null >/dev/null 2>&1 && print_error "Test 21 FAILED (Expected failure)"
+print_status "Test 21 PASSED"
+
+# Test 22: Fused pure stages give the same output as the plain chain
+# (two loggers interleave in any order, so compare sorted)
+print_status "Running Test 22: --fuse matches the unfused chain"
+INPUT=$(printf "Line %d abc\n" {1..500}; echo "<END>")
+EXPECTED=$(echo "$INPUT" | $ANALYZER 10 uppercaser rotator flipper expander logger uppercaser:2 rotator logger | grep "^\[logger\]" | sort)
+ACTUAL=$(echo "$INPUT" | $ANALYZER --fuse 10 uppercaser rotator flipper expander logger uppercaser:2 rotator logger | grep "^\[logger\]" | sort || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 22 FAILED (fused output differs)"
+$ANALYZER --bogus 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 22 FAILED (unknown option accepted)"
+print_status "Test 22 PASSED"
+
+# Test 23: Lines longer than the old 1024-byte limit arrive whole
+print_status "Running Test 23: 200000-char line stays one message"
+LONG=$(head -c 200000 /dev/zero | tr '\0' 'b')
+ACTUAL=$(printf "%s\nshort\n<END>\n" "$LONG" | $ANALYZER 10 uppercaser logger | grep "^\[logger\]" || true)
+[ "$(echo "$ACTUAL" | wc -l)" -eq 2 ] || print_error "Test 23 FAILED (Expected 2 lines)"
+[ "$(echo "$ACTUAL" | head -1 | wc -c)" -eq $((9 + 200000 + 1)) ] || print_error "Test 23 FAILED (long line length)"
+print_status "Test 23 PASSED"
+
+# Test 24: Final line without a newline is still processed
+print_status "Running Test 24: Unterminated last line"
+ACTUAL=$(printf "one\ntwo" | $ANALYZER 10 uppercaser logger | grep "^\[logger\]" || true)
+[ "$ACTUAL" == "$(printf '[logger] ONE\n[logger] TWO')" ] || print_error "Test 24 FAILED (got '$ACTUAL')"
+print_status "Test 24 PASSED"
+
+# Test 25: --input maps a file and gives the same output as stdin
+print_status "Running Test 25: --input file matches stdin"
+INFILE=$(mktemp)
+{ printf "Line %d abc\n" {1..3000}; head -c 70000 /dev/zero | tr '\0' 'q'; printf "\nlast"; } > "$INFILE"
+for CHAIN in "flipper rotator uppercaser logger" "uppercaser:3 expander logger" "logger"; do
+    EXPECTED=$($ANALYZER 16 $CHAIN < "$INFILE" | grep "^\[logger\]")
+    ACTUAL=$($ANALYZER --input "$INFILE" 16 $CHAIN | grep "^\[logger\]" || true)
+    [ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 25 FAILED (chain '$CHAIN' differs)"
+done
+ACTUAL=$(cat "$INFILE" | $ANALYZER --input /dev/stdin 16 flipper logger | grep -c "^\[logger\]" || true)
+[ "$ACTUAL" -eq 3002 ] || print_error "Test 25 FAILED (piped --input gave $ACTUAL lines)"
+rm -f "$INFILE"
+$ANALYZER --input /nonexistent/file 10 logger >/dev/null 2>&1 && print_error "Test 25 FAILED (missing input accepted)"
+print_status "Test 25 PASSED"
+
+# Test 26: Buffered logger writes the same lines, and not later than its bound
+print_status "Running Test 26: Buffered logger output"
+INPUT=$(printf "row %d\n" {1..5000}; head -c 100000 /dev/zero | tr '\0' 'z'; echo; echo "<END>")
+EXPECTED=$(echo "$INPUT" | $ANALYZER 10 uppercaser logger | grep "^\[logger\]")
+ACTUAL=$(echo "$INPUT" | LOGGER_BUFFER=4096 $ANALYZER 10 uppercaser logger | grep "^\[logger\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 26 FAILED (buffered output differs)"
+OUTFILE=$(mktemp)
+( echo "early"; sleep 2; echo "<END>" ) | LOGGER_BUFFER=65536 LOGGER_FLUSH_MS=100 $ANALYZER 10 logger > "$OUTFILE" &
+sleep 1
+grep -q "^\[logger\] early" "$OUTFILE" || print_error "Test 26 FAILED (line held past the flush bound)"
+wait
+tail -1 "$OUTFILE" | grep -q "Pipeline shutdown complete" || print_error "Test 26 FAILED (shutdown line not last)"
+rm -f "$OUTFILE"
+print_status "Test 26 PASSED"
+
+
+# Test 27: Typewriter forwards at once; a display that falls behind drops lines
+# instead of holding up the chain (50 lines typed at 100 ms/char take ~40 s)
+print_status "Running Test 27: Typewriter does not stall the chain"
+EXPECTED=$(printf "[typewriter] typed %d\n" {1..3})
+ACTUAL=$(printf "typed %d\n" {1..3} | FAST_TYPEWRITER=10 $ANALYZER 10 typewriter logger | grep "^\[typewriter\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 27 FAILED (typed lines differ)"
+START=$SECONDS
+ACTUAL=$(printf "line %d\n" {1..50} | FAST_TYPEWRITER=100 TYPEWRITER_BUFFER=64 $ANALYZER 10 typewriter logger)
+[ $((SECONDS - START)) -lt 15 ] || print_error "Test 27 FAILED (typewriter held up the chain)"
+[ "$(echo "$ACTUAL" | grep -c "^\[logger\]")" -eq 50 ] || print_error "Test 27 FAILED (lines lost downstream)"
+echo "$ACTUAL" | grep -q "^\[typewriter\] ([0-9]* lines\? skipped)" || print_error "Test 27 FAILED (no drop report)"
+# the logger prints a line while it is still being typed (40 chars at
+# 100 ms take ~4 s), not once the typewriter is done with it, and neither
+# line breaks into the other
+OUTFILE=$(mktemp)
+LONG_LINE=$(printf "%040d" 7)
+echo "$LONG_LINE" | FAST_TYPEWRITER=100 $ANALYZER 10 typewriter logger > "$OUTFILE" &
+TYPING_PID=$!
+sleep 1
+grep -qx "\[logger\] $LONG_LINE" "$OUTFILE" || print_error "Test 27 FAILED (logger waited for the typewriter)"
+wait $TYPING_PID
+grep -qx "\[typewriter\] $LONG_LINE" "$OUTFILE" || print_error "Test 27 FAILED (long line typed wrong)"
+rm -f "$OUTFILE"
+# a line larger than the whole display buffer is typed, in order, not dropped
+LONG_LINE=$(printf "%0200d" 7)
+EXPECTED=$(printf "[typewriter] %s\n" a "$LONG_LINE" b)
+ACTUAL=$(printf "a\n%s\nb\n" "$LONG_LINE" | FAST_TYPEWRITER=1 TYPEWRITER_BUFFER=64 $ANALYZER 10 typewriter | grep "^\[typewriter\]" || true)
+[ "$ACTUAL" == "$EXPECTED" ] || print_error "Test 27 FAILED (line larger than the buffer: '$ACTUAL')"
+print_status "Test 27 PASSED"
+
+# Test 28: --metrics prints a row per stage at shutdown and on SIGUSR1
+print_status "Running Test 28: Per-stage metrics"
+ERRFILE=$(mktemp)
+ACTUAL=$(printf "row %d\n" {1..300} | $ANALYZER --metrics --fuse 10 uppercaser rotator flipper:2 logger 2>"$ERRFILE" | grep -c "^\[logger\]" || true)
+[ "$ACTUAL" -eq 300 ] || print_error "Test 28 FAILED (output changed with metrics on)"
+ROWS=$(grep "^\[metrics\] " "$ERRFILE" | awk 'NR > 1 {print $2, $3, $4, $5}')
+EXPECTED=$'uppercaser+rotator+flipper:2 2 301 300\nlogger 1 301 300'
+[ "$ROWS" == "$EXPECTED" ] || print_error "Test 28 FAILED (unexpected table: $ROWS)"
+$ANALYZER --metrics 10 logger < <(echo "before"; sleep 1.5; echo "<END>") >/dev/null 2>"$ERRFILE" &
+sleep 0.7
+kill -USR1 $!
+wait $!
+[ "$(grep -c "^\[metrics\] logger " "$ERRFILE")" -ge 2 ] || print_error "Test 28 FAILED (no table on SIGUSR1)"
+rm -f "$ERRFILE"
+print_status "Test 28 PASSED"
+
+# Test 29: --latency prints queue/transform rows per stage and end to end
+print_status "Running Test 29: Latency histograms"
+ERRFILE=$(mktemp)
+ACTUAL=$(printf "row %d\n" {1..500} | $ANALYZER --latency 10 uppercaser:2 flipper logger 2>"$ERRFILE" | grep -c "^\[logger\]" || true)
+[ "$ACTUAL" -eq 500 ] || print_error "Test 29 FAILED (output changed with latency on)"
+ROWS=$(grep "^\[latency\] " "$ERRFILE" | awk 'NR > 1 {print $2, $3, $4}')
+EXPECTED=$'uppercaser:2 queue 500\nuppercaser:2 transform 500\nflipper queue 500\nflipper transform 500\nlogger queue 500\nlogger transform 500\nlogger end-to-end 500'
+[ "$ROWS" == "$EXPECTED" ] || print_error "Test 29 FAILED (unexpected table: $ROWS)"
+rm -f "$ERRFILE"
+print_status "Test 29 PASSED"
+
+# Test 30: Lossy overflow policies keep order, account for every line and
+# still shut down (every line is either logged or counted as dropped)
+print_status "Running Test 30: Overflow policies"
+ERRFILE=$(mktemp)
+for SPEC in "1 uppercaser@drop-newest logger" "1 uppercaser logger@drop-oldest" "--overflow timeout:0 1 uppercaser:2 uppercaser logger"; do
+    ACTUAL=$(printf "row %d\n" {1..5000} | $ANALYZER --metrics $SPEC 2>"$ERRFILE" | grep "^\[logger\]" || true)
+    LOGGED=$(echo "$ACTUAL" | grep -c . || true)
+    DROPPED=$(grep "^\[metrics\] " "$ERRFILE" | awk 'NR > 1 {sum += $NF} END {print sum + 0}')
+    [ $((LOGGED + DROPPED)) -eq 5000 ] || print_error "Test 30 FAILED ('$SPEC': $LOGGED logged, $DROPPED dropped)"
+    echo "$ACTUAL" | awk '{n = $NF + 0; if (n <= prev) exit 1; prev = n}' || print_error "Test 30 FAILED ('$SPEC' out of order)"
+done
+rm -f "$ERRFILE"
+$ANALYZER 10 logger@bogus </dev/null >/dev/null 2>&1 && print_error "Test 30 FAILED (bad policy accepted)"
+$ANALYZER --overflow timeout:x 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 30 FAILED (bad --overflow accepted)"
+# --fuse keeps the queue a stage names a policy for
+ROWS=$(printf "row %d\n" {1..50} | $ANALYZER --fuse --metrics 10 uppercaser rotator@drop-newest logger 2>&1 >/dev/null | awk '/^\[metrics\] / {print $2}')
+echo "$ROWS" | grep -qx "rotator@drop-newest" || print_error "Test 30 FAILED (stage with its own policy was fused: $ROWS)"
+print_status "Test 30 PASSED"
+
+# Test 31: Pinned, busy-polling workers give the same output; a pin list
+# short of one cpu per thread is refused
+print_status "Running Test 31: --pin and --spin"
+EXPECTED=$(printf "line %d\n" {1..500} | $ANALYZER 4 uppercaser flipper:2 logger 2>/dev/null | sort)
+ACTUAL=$(printf "line %d\n" {1..500} | $ANALYZER --pin 0,0,0-0,0,0 --spin 20 4 uppercaser flipper:2 logger 2>/dev/null | sort)
+[ "$EXPECTED" == "$ACTUAL" ] || print_error "Test 31 FAILED (output differs)"
+$ANALYZER --pin 0,0 10 uppercaser logger </dev/null >/dev/null 2>&1 && print_error "Test 31 FAILED (short pin list accepted)"
+$ANALYZER --pin x 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 31 FAILED (bad pin list accepted)"
+$ANALYZER --spin 20x 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 31 FAILED (bad spin time accepted)"
+print_status "Test 31 PASSED"
+
+# Test 32: --graph fans out (every branch sees every line) and fans in (the
+# merge stage gets both branches and stops after the last <END>); the
+# result equals the linear chains it is made of
+print_status "Running Test 32: Graph fan-out and fan-in"
+EXPECTED=$(printf "row %d\n" {1..2000} | $ANALYZER 4 rotator uppercaser flipper logger | grep "^\[logger\]";
+           printf "row %d\n" {1..2000} | $ANALYZER 4 rotator expander logger | grep "^\[logger\]")
+EXPECTED=$(echo "$EXPECTED" | sort)
+for FLAGS in "" "--fuse"; do
+    ACTUAL=$(printf "row %d\n" {1..2000} | $ANALYZER $FLAGS --graph 'src = rotator; src -> uppercaser:2 -> flipper -> join
+                                                                   src -> expander -> join; join = logger' 4 | grep "^\[logger\]" | sort)
+    [ "$EXPECTED" == "$ACTUAL" ] || print_error "Test 32 FAILED (diamond graph '$FLAGS' differs)"
+done
+EXPECTED=$'[logger] HELLO\n[logger] O L L E H'
+ACTUAL=$(echo "hello" | $ANALYZER --graph 'uppercaser -> logger; uppercaser -> flipper -> expander -> out; out = logger' 10 | grep "^\[logger\]" | sort)
+[ "$EXPECTED" == "$ACTUAL" ] || print_error "Test 32 FAILED (Expected:\n$EXPECTED\nGot:\n$ACTUAL)"
+$ANALYZER --graph 'a = logger; a -> b; b -> a' 10 </dev/null >/dev/null 2>&1 && print_error "Test 32 FAILED (cycle accepted)"
+$ANALYZER --graph 'logger' 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 32 FAILED (stages after --graph accepted)"
+print_status "Test 32 PASSED"
+
+# Test 33: --partitions runs copies of the chain side by side; every line
+# arrives once, and the lines of one key keep their order
+print_status "Running Test 33: Hash-partitioned chains"
+for i in {1..3000}; do echo "k$((i % 7)),$i"; done > /tmp/partition_input.txt
+EXPECTED=$($ANALYZER 8 uppercaser flipper flipper logger < /tmp/partition_input.txt | grep "^\[logger\]" | sort)
+for FLAGS in "--key 1" "--key 1 --fuse" "--key line" "--key 1 --input /tmp/partition_input.txt"; do
+    ACTUAL=$($ANALYZER --partitions 3 $FLAGS 8 uppercaser flipper:2 flipper logger < /tmp/partition_input.txt | grep "^\[logger\]")
+    [ "$EXPECTED" == "$(echo "$ACTUAL" | sort)" ] || print_error "Test 33 FAILED (partitions '$FLAGS' differ)"
+    # with --key 1 the lines of one kN share a copy, so they stay in order
+    [[ "$FLAGS" == "--key line" ]] && continue
+    echo "$ACTUAL" | awk -F'[ ,]' '$2 in last && $3 <= last[$2] { bad = 1 } { last[$2] = $3 } END { exit bad }' \
+        || print_error "Test 33 FAILED (a key out of order with '$FLAGS')"
+done
+rm -f /tmp/partition_input.txt
+$ANALYZER --partitions 2 10 logger </dev/null >/dev/null 2>&1 && print_error "Test 33 FAILED (nothing to partition accepted)"
+$ANALYZER --key 1 10 uppercaser logger </dev/null >/dev/null 2>&1 && print_error "Test 33 FAILED (--key without --partitions accepted)"
+for K in 4x 0 2147483647; do
+    $ANALYZER --partitions $K 10 uppercaser logger </dev/null >/dev/null 2>&1 && print_error "Test 33 FAILED (--partitions $K accepted)"
+done
+print_status "Test 33 PASSED"
+
+# Test 34: A plugin built against the original string SDK (no
+# plugin_instance_* symbols) still loads, next to the current plugins, as a
+# single instance; repeating it is refused
+print_status "Running Test 34: Legacy string-SDK plugin"
+gcc -shared -fPIC -O2 tests/legacy_plugin.c -lpthread -o output/legacy.so
+EXPECTED=$(printf "row %d\n" {1..500} | $ANALYZER 4 uppercaser flipper rotator logger | grep "^\[logger\]")
+ACTUAL=$(printf "row %d\n" {1..500} | $ANALYZER 4 uppercaser legacy rotator logger | grep "^\[logger\]")
+[ "$EXPECTED" == "$ACTUAL" ] || print_error "Test 34 FAILED (legacy stage mid-chain differs)"
+printf "row %d\n" {1..500} > /tmp/legacy_input.txt
+ACTUAL=$($ANALYZER --input /tmp/legacy_input.txt 4 legacy uppercaser:2 flipper logger | grep "^\[logger\]")
+EXPECTED=$(tr a-z A-Z < /tmp/legacy_input.txt | sed 's/^/[logger] /')
+rm -f /tmp/legacy_input.txt
+[ "$EXPECTED" == "$ACTUAL" ] || print_error "Test 34 FAILED (legacy first stage differs)"
+$ANALYZER 4 legacy legacy logger </dev/null >/dev/null 2>&1 && print_error "Test 34 FAILED (repeated legacy plugin accepted)"
+# --pin hands cpus to the reader and logger only; legacy takes none
+ACTUAL=$(echo "abc" | $ANALYZER --pin 0,0 --spin 20 4 legacy logger 2>/dev/null | grep "^\[logger\]")
+[ "$ACTUAL" == "[logger] cba" ] || print_error "Test 34 FAILED (--pin counted a cpu for the legacy stage)"
+rm -f output/legacy.so
+print_status "Test 34 PASSED"
 
 echo -e "\n${GREEN}[TEST] All tests PASSED ✔${NC}"
\ No newline at end of file
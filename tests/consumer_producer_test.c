@@ -9,6 +9,8 @@
 #include <limits.h>
 #include <stdbool.h>
 #include "../plugins/sync/consumer_producer.h"
+#include "../plugins/sync/msg_pool.h"
+#include "../plugins/sync/lat_hist.h"
 
 // Test configuration
 #define MAX_TEST_THREADS 8
@@ -64,6 +66,128 @@ char* create_test_string(int value) {
     return str;
 }
 
+int test_put_owned_no_copy() {
+    print_test_header("Owned Put Hands Over The Buffer");
+    
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2; b++) {
+        consumer_producer_t queue;
+        if (consumer_producer_init_backend(&queue, 2, backends[b]) != 0) {
+            success = 0;
+            continue;
+        }
+        char* item = create_test_string(42);
+        if (consumer_producer_put_owned(&queue, item) != 0) {
+            free(item);
+            success = 0;
+        } else {
+            char* got = consumer_producer_get(&queue);
+            if (got != item) {
+                printf("    Backend %d returned a different buffer\n", b);
+                success = 0;
+            }
+            free(got);
+        }
+        // a finished queue refuses the buffer and leaves it with the caller
+        consumer_producer_signal_finished(&queue);
+        item = create_test_string(43);
+        if (consumer_producer_put_owned(&queue, item) == 0) success = 0;
+        free(item);
+        consumer_producer_destroy(&queue);
+    }
+    
+    print_test_result("Owned Put Hands Over The Buffer", success);
+    return success;
+}
+
+int test_batch_put_get() {
+    print_test_header("Batch Put/Get");
+    
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2 && success; b++) {
+        consumer_producer_t queue;
+        if (consumer_producer_init_backend(&queue, 5, backends[b]) != 0) {
+            success = 0;
+            break;
+        }
+        printf("  Backend %d: batches across the wrap point...\n", b);
+        int next_put = 0, next_get = 0;
+        for (int round = 0; round < 6 && success; round++) {
+            char* items[4];
+            for (int i = 0; i < 4; i++) items[i] = create_test_string(next_put++);
+            if (consumer_producer_put_batch(&queue, items, 4) != 4) success = 0;
+            
+            // take in two smaller bites to check max is honoured
+            char* out[4];
+            for (int bite = 0; bite < 2; bite++) {
+                int n = consumer_producer_get_batch(&queue, out, 2);
+                if (n != 2) success = 0;
+                for (int i = 0; i < n; i++) {
+                    char expected[32];
+                    snprintf(expected, sizeof(expected), "test_item_%d", next_get++);
+                    if (strcmp(out[i], expected) != 0) {
+                        printf("    Expected '%s', got '%s'\n", expected, out[i]);
+                        success = 0;
+                    }
+                    free(out[i]);
+                }
+            }
+        }
+        
+        // a finished queue reports 0 once drained
+        char* last = create_test_string(100);
+        consumer_producer_put_batch(&queue, &last, 1);
+        consumer_producer_signal_finished(&queue);
+        char* out[4];
+        int n = consumer_producer_get_batch(&queue, out, 4);
+        if (n != 1 || strcmp(out[0], "test_item_100") != 0) success = 0;
+        if (n > 0) free(out[0]);
+        if (consumer_producer_get_batch(&queue, out, 4) != 0) success = 0;
+        
+        consumer_producer_destroy(&queue);
+    }
+    
+    print_test_result("Batch Put/Get", success);
+    return success;
+}
+
+int test_message_roundtrip() {
+    print_test_header("Length-Carrying Messages");
+    
+    consumer_producer_t queue;
+    if (consumer_producer_init_backend(&queue, 4, CP_BACKEND_SPSC) != 0) {
+        print_test_result("Message Setup", 0);
+        return 0;
+    }
+    
+    printf("  Testing embedded NULs survive the queue...\n");
+    const char bytes[] = {'a', '\0', 'b', '\0', 'c'};
+    msg_t m;
+    msg_from_bytes(&m, bytes, sizeof(bytes));
+    char* sent = m.data;
+    int success = consumer_producer_put_msg(&queue, &m) == 0;
+    
+    msg_t got;
+    success = success && consumer_producer_get_msg(&queue, &got) == 0;
+    success = success && got.data == sent && got.len == sizeof(bytes) &&
+              memcmp(got.data, bytes, sizeof(bytes)) == 0 && !msg_is_end(&got);
+    msg_release(&got);
+    
+    printf("  Testing the string shim flags <END>...\n");
+    consumer_producer_put(&queue, "<END>");
+    consumer_producer_put(&queue, "<END>x");
+    success = success && consumer_producer_get_msg(&queue, &got) == 0 && msg_is_end(&got);
+    msg_release(&got);
+    success = success && consumer_producer_get_msg(&queue, &got) == 0 && !msg_is_end(&got);
+    msg_release(&got);
+    
+    consumer_producer_destroy(&queue);
+    print_test_result("Length-Carrying Messages", success);
+    return success;
+}
+
 // =============================================================================
 // EDGE CASE TESTS  
 // =============================================================================
@@ -943,6 +1067,695 @@ int test_stress_high_frequency() {
     return success;
 }
 
+// =============================================================================
+// SPSC BACKEND TESTS
+// =============================================================================
+
+int test_spsc_wrapping_and_capacity() {
+    print_test_header("SPSC Wrapping and Capacity");
+    
+    consumer_producer_t queue;
+    if (consumer_producer_init_backend(&queue, 3, CP_BACKEND_SPSC) != 0) {  // 4 slots, capacity 3
+        print_test_result("SPSC Setup", 0);
+        return 0;
+    }
+    
+    printf("  Testing wrap-around over several rounds...\n");
+    int success = 1;
+    int next_put = 0, next_get = 0;
+    for (int round = 0; round < 10 && success; round++) {
+        for (int i = 0; i < 3; i++) {
+            char item[32];
+            snprintf(item, sizeof(item), "test_item_%d", next_put++);
+            consumer_producer_put(&queue, item);
+        }
+        for (int i = 0; i < 2; i++) {
+            char expected[32];
+            snprintf(expected, sizeof(expected), "test_item_%d", next_get++);
+            char* got = consumer_producer_get(&queue);
+            if (!got || strcmp(got, expected) != 0) {
+                printf("    Expected '%s', got '%s'\n", expected, got ? got : "NULL");
+                success = 0;
+            }
+            free(got);
+        }
+        // drain the leftover so every round starts at a new offset
+        char* got = consumer_producer_get(&queue);
+        next_get++;
+        free(got);
+    }
+    
+    printf("  Testing producer blocks at logical capacity...\n");
+    for (int i = 0; i < 3; i++) consumer_producer_put(&queue, "fill");
+    
+    blocking_test_data_t producer_data = {&queue, 0, NULL};
+    pthread_t producer_thread;
+    pthread_create(&producer_thread, NULL, blocking_producer_thread, &producer_data);
+    usleep(100000);  // 100ms
+    
+    if (producer_data.operation_completed) {
+        printf("    Producer did not block with 3 items in a capacity-3 queue\n");
+        success = 0;
+    }
+    
+    char* removed = consumer_producer_get(&queue);
+    free(removed);
+    pthread_join(producer_thread, NULL);
+    success = success && producer_data.operation_completed;
+    
+    consumer_producer_signal_finished(&queue);
+    char* item;
+    int drained = 0;
+    while ((item = consumer_producer_get(&queue)) != NULL) {
+        drained++;
+        free(item);
+    }
+    if (drained != 3) {
+        printf("    Expected 3 items drained after finish, got %d\n", drained);
+        success = 0;
+    }
+    
+    consumer_producer_destroy(&queue);
+    print_test_result("SPSC Wrapping and Capacity", success);
+    return success;
+}
+
+int test_spsc_blocking_consumer() {
+    print_test_header("SPSC Consumer Parking");
+    
+    consumer_producer_t queue;
+    if (consumer_producer_init_backend(&queue, 2, CP_BACKEND_SPSC) != 0) {
+        print_test_result("SPSC Setup", 0);
+        return 0;
+    }
+    
+    blocking_test_data_t consumer_data = {&queue, 0, NULL};
+    pthread_t consumer_thread;
+    pthread_create(&consumer_thread, NULL, blocking_consumer_thread, &consumer_data);
+    usleep(100000);  // 100ms
+    
+    int success = !consumer_data.operation_completed;
+    consumer_producer_put(&queue, "test_item_7");
+    pthread_join(consumer_thread, NULL);
+    
+    success = success && consumer_data.result_item &&
+              strcmp(consumer_data.result_item, "test_item_7") == 0;
+    free(consumer_data.result_item);
+    
+    // a parked consumer must also wake up on finish
+    blocking_test_data_t finish_data = {&queue, 0, NULL};
+    pthread_create(&consumer_thread, NULL, blocking_consumer_thread, &finish_data);
+    usleep(100000);  // 100ms
+    consumer_producer_signal_finished(&queue);
+    pthread_join(consumer_thread, NULL);
+    success = success && finish_data.operation_completed && finish_data.result_item == NULL;
+    
+    consumer_producer_destroy(&queue);
+    print_test_result("SPSC Consumer Parking", success);
+    return success;
+}
+
+#define SPSC_STRESS_ITEMS 200000
+
+void* spsc_ordered_producer(void* arg) {
+    consumer_producer_t* queue = (consumer_producer_t*)arg;
+    char item[32];
+    for (int i = 0; i < SPSC_STRESS_ITEMS; i++) {
+        snprintf(item, sizeof(item), "%d", i);
+        if (consumer_producer_put(queue, item) != 0) break;
+    }
+    return NULL;
+}
+
+int test_spsc_stress_ordering() {
+    print_test_header("SPSC Stress - Ordering");
+    
+    consumer_producer_t queue;
+    if (consumer_producer_init_backend(&queue, 5, CP_BACKEND_SPSC) != 0) {
+        print_test_result("SPSC Setup", 0);
+        return 0;
+    }
+    
+    printf("  Passing %d items through a capacity-5 ring...\n", SPSC_STRESS_ITEMS);
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_ordered_producer, &queue);
+    
+    int success = 1;
+    for (int i = 0; i < SPSC_STRESS_ITEMS; i++) {
+        char* got = consumer_producer_get(&queue);
+        if (!got || atoi(got) != i) {
+            printf("    Out of order at %d: got '%s'\n", i, got ? got : "NULL");
+            free(got);
+            success = 0;
+            break;
+        }
+        free(got);
+    }
+    
+    consumer_producer_signal_finished(&queue);
+    pthread_join(producer, NULL);
+    consumer_producer_destroy(&queue);
+    print_test_result("SPSC Stress - Ordering", success);
+    return success;
+}
+
+// =============================================================================
+// QUEUE STATS TESTS
+// =============================================================================
+
+// fills a capacity-2 queue with 4 items, so it has to block twice
+void* stats_producer(void* arg) {
+    consumer_producer_t* queue = (consumer_producer_t*)arg;
+    const char* items[] = {"a", "b", "c", "d"};
+    for (int i = 0; i < 4; i++) {
+        if (consumer_producer_put(queue, items[i]) != 0) break;
+    }
+    return NULL;
+}
+
+int test_queue_stats() {
+    print_test_header("Queue Stats Counters");
+
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2 && success; b++) {
+        consumer_producer_t queue;
+        if (consumer_producer_init_backend(&queue, 2, backends[b]) != 0) {
+            print_test_result("Stats Setup", 0);
+            return 0;
+        }
+        consumer_producer_enable_stats(&queue);
+
+        pthread_t producer;
+        pthread_create(&producer, NULL, stats_producer, &queue);
+        usleep(100000);  // 100ms: producer is stuck on the full queue
+
+        cp_stats_snapshot_t st;
+        consumer_producer_read_stats(&queue, &st);
+        success = success && st.puts == 2 && st.depth == 2 && st.high_water == 2;
+
+        for (int i = 0; i < 4; i++) free(consumer_producer_get(&queue));
+        pthread_join(producer, NULL);
+
+
+        consumer_producer_read_stats(&queue, &st);
+        success = success && st.puts == 4 && st.gets == 4 && st.depth == 0 &&
+                  st.high_water == 2 && st.put_wait_ns >= 50000000ull;
+        if (!success) {
+            printf("    backend %d: puts=%llu gets=%llu max=%llu put_wait=%llu ns\n", b,
+                   (unsigned long long)st.puts, (unsigned long long)st.gets,
+                   (unsigned long long)st.high_water, (unsigned long long)st.put_wait_ns);
+        }
+        consumer_producer_destroy(&queue);
+    }
+
+    // counters stay at zero unless enabled
+    consumer_producer_t plain;
+    consumer_producer_init(&plain, 2);
+    consumer_producer_put(&plain, "x");
+    cp_stats_snapshot_t st;
+    consumer_producer_read_stats(&plain, &st);
+    success = success && st.puts == 0;
+    consumer_producer_destroy(&plain);
+
+    print_test_result("Queue Stats Counters", success);
+    return success;
+}
+
+// =============================================================================
+// OVERFLOW POLICY TESTS
+// =============================================================================
+
+static uint64_t test_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// puts the <END> sentinel into a full lossy queue
+void* end_producer(void* arg) {
+    consumer_producer_put((consumer_producer_t*)arg, "<END>");
+    return NULL;
+}
+
+int test_overflow_policies() {
+    print_test_header("Overflow Policies");
+
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2 && success; b++) {
+        printf("  Testing drop-newest keeps the first items (backend %d)...\n", b);
+        consumer_producer_t queue;
+        consumer_producer_init_backend(&queue, 2, backends[b]);
+        success = consumer_producer_set_overflow(&queue, CP_OVERFLOW_DROP_NEWEST, 0) == 0;
+        char* items[5];
+        for (int i = 0; i < 5; i++) items[i] = create_test_string(i);
+        success = success && consumer_producer_put_batch(&queue, items, 5) == 5;
+
+        printf("  Testing <END> waits for room instead of being dropped...\n");
+        pthread_t producer;
+        pthread_create(&producer, NULL, end_producer, &queue);
+        usleep(50000);
+        char* got[3];
+        for (int i = 0; i < 3; i++) got[i] = consumer_producer_get(&queue);
+        pthread_join(producer, NULL);
+        success = success && got[0] && strcmp(got[0], "test_item_0") == 0;
+        success = success && got[1] && strcmp(got[1], "test_item_1") == 0;
+        success = success && got[2] && strcmp(got[2], "<END>") == 0;
+        for (int i = 0; i < 3; i++) free(got[i]);
+
+        cp_stats_snapshot_t st;
+        consumer_producer_read_stats(&queue, &st);
+        success = success && st.dropped == 3 && st.evicted == 0 && st.timeouts == 0;
+
+        // the ring's read end belongs to its consumer
+        success = success && (consumer_producer_set_overflow(&queue, CP_OVERFLOW_DROP_OLDEST, 0) == 0) ==
+                             (backends[b] == CP_BACKEND_LOCKED);
+        consumer_producer_destroy(&queue);
+    }
+
+    printf("  Testing drop-oldest keeps the latest items...\n");
+    consumer_producer_t queue;
+    consumer_producer_init(&queue, 2);
+    consumer_producer_enable_stats(&queue);
+    success = success && consumer_producer_set_overflow(&queue, CP_OVERFLOW_DROP_OLDEST, 0) == 0;
+    for (int i = 0; i < 5; i++) success = success && consumer_producer_put_owned(&queue, create_test_string(i)) == 0;
+    char* a = consumer_producer_get(&queue);
+    char* b2 = consumer_producer_get(&queue);
+    success = success && a && strcmp(a, "test_item_3") == 0 && b2 && strcmp(b2, "test_item_4") == 0;
+    free(a);
+    free(b2);
+    cp_stats_snapshot_t st;
+    consumer_producer_read_stats(&queue, &st);
+    success = success && st.evicted == 3 && st.depth == 0;
+    consumer_producer_destroy(&queue);
+
+    printf("  Testing timeout blocks for its bound, then drops...\n");
+    consumer_producer_init_backend(&queue, 1, CP_BACKEND_SPSC);
+    success = success && consumer_producer_set_overflow(&queue, CP_OVERFLOW_TIMEOUT, 50) == 0;
+    consumer_producer_put(&queue, "kept");
+    uint64_t t0 = test_now_ms();
+    success = success && consumer_producer_put(&queue, "late") == 0;
+    uint64_t waited = test_now_ms() - t0;
+    consumer_producer_read_stats(&queue, &st);
+    success = success && waited >= 45 && waited < 1000 && st.dropped == 1 && st.timeouts == 1;
+    consumer_producer_destroy(&queue);
+
+    print_test_result("Overflow Policies", success);
+    return success;
+}
+
+int test_timed_operations() {
+    print_test_header("Timed Put/Get");
+
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2 && success; b++) {
+        consumer_producer_t queue;
+        consumer_producer_init_backend(&queue, 1, backends[b]);
+
+        printf("  Testing get on an empty queue times out (backend %d)...\n", b);
+        msg_t m;
+        uint64_t t0 = test_now_ms();
+        success = consumer_producer_get_msg_timed(&queue, &m, 30) == 1;
+        uint64_t waited = test_now_ms() - t0;
+        success = success && waited >= 25 && waited < 1000;
+
+        printf("  Testing put on a full queue times out and hands the item back...\n");
+        success = success && consumer_producer_put(&queue, "first") == 0;
+        msg_from_cstr(&m, "second");
+        success = success && consumer_producer_put_msg_timed(&queue, &m, 30) == 1 && m.data;
+        msg_release(&m);
+
+        success = success && consumer_producer_get_msg_timed(&queue, &m, 30) == 0 &&
+                  m.len == 5 && memcmp(m.data, "first", 5) == 0;
+        msg_release(&m);
+
+        printf("  Testing a finished queue ends timed waits...\n");
+        consumer_producer_signal_finished(&queue);
+        success = success && consumer_producer_get_msg_timed(&queue, &m, 1000) == -1;
+        consumer_producer_destroy(&queue);
+    }
+
+    printf("  Testing a timed monitor wait gives up...\n");
+    monitor_t mon;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    monitor_init(&mon);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t deadline = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 20000000u;
+    pthread_mutex_lock(&lock);
+    success = success && monitor_timedwait_locked(&mon, &lock, deadline) == MONITOR_TIMEDOUT;
+    monitor_signal_locked(&mon, &lock);
+    success = success && monitor_timedwait_locked(&mon, &lock, deadline) == 0;
+    pthread_mutex_unlock(&lock);
+    success = success && mon.waiters == 0;
+    monitor_destroy(&mon);
+
+    print_test_result("Timed Put/Get", success);
+    return success;
+}
+
+// =============================================================================
+// MONITOR TESTS
+// =============================================================================
+
+typedef struct {
+    monitor_t* mon;
+    pthread_mutex_t* lock;
+    int rounds;
+    atomic_int woken;
+} monitor_test_data_t;
+
+// waits rounds times, each wait consuming one signal
+void* monitor_waiter(void* arg) {
+    monitor_test_data_t* d = (monitor_test_data_t*)arg;
+    pthread_mutex_lock(d->lock);
+    for (int i = 0; i < d->rounds; i++) {
+        if (monitor_wait_locked(d->mon, d->lock) != 0) break;
+        atomic_fetch_add(&d->woken, 1);
+    }
+    pthread_mutex_unlock(d->lock);
+    return NULL;
+}
+
+int test_monitor_eventcount() {
+    print_test_header("Monitor Eventcount");
+
+    monitor_t mon;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    int success = monitor_init(&mon) == 0;
+
+    printf("  Testing a signal with no waiter stays sticky and skips the wake...\n");
+    pthread_mutex_lock(&lock);
+    monitor_signal_locked(&mon, &lock);
+    success = success && mon.signaled == 1 && atomic_load(&mon.seq) == 0;
+    success = success && monitor_wait_locked(&mon, &lock) == 0 && mon.signaled == 0;
+    pthread_mutex_unlock(&lock);
+
+    printf("  Testing a sleeping waiter is woken once per signal...\n");
+    monitor_test_data_t d = { .mon = &mon, .lock = &lock, .rounds = 3 };
+    atomic_init(&d.woken, 0);
+    pthread_t waiter;
+    pthread_create(&waiter, NULL, monitor_waiter, &d);
+    for (int i = 1; i <= 3 && success; i++) {
+        usleep(50000);
+        success = atomic_load(&d.woken) == i - 1;
+        pthread_mutex_lock(&lock);
+        monitor_signal_locked(&mon, &lock);
+        pthread_mutex_unlock(&lock);
+        for (int t = 0; t < 200 && atomic_load(&d.woken) < i; t++) usleep(5000);
+        success = success && atomic_load(&d.woken) == i;
+    }
+    if (!success) {
+        // release the waiter whatever round it is in
+        for (int i = 0; i < 3; i++) {
+            pthread_mutex_lock(&lock);
+            monitor_signal_locked(&mon, &lock);
+            pthread_mutex_unlock(&lock);
+            usleep(10000);
+        }
+    }
+    pthread_join(waiter, NULL);
+    success = success && mon.waiters == 0 && mon.woken == 0;
+
+    monitor_destroy(&mon);
+    print_test_result("Monitor Eventcount", success);
+    return success;
+}
+
+int test_busy_poll_consumer() {
+    print_test_header("Busy-Poll Consumer");
+
+    int success = 1;
+    cp_backend_t backends[] = {CP_BACKEND_LOCKED, CP_BACKEND_SPSC};
+    for (int b = 0; b < 2 && success; b++) {
+        consumer_producer_t queue;
+        consumer_producer_init_backend(&queue, 4, backends[b]);
+
+        printf("  Testing an item put while the consumer polls (backend %d)...\n", b);
+        consumer_producer_set_spin(&queue, 500000000u);  // 500ms
+        blocking_test_data_t polled = {&queue, 0, NULL};
+        pthread_t consumer_thread;
+        pthread_create(&consumer_thread, NULL, blocking_consumer_thread, &polled);
+        usleep(20000);  // 20ms
+        success = !polled.operation_completed;
+        consumer_producer_put(&queue, "polled_item");
+        pthread_join(consumer_thread, NULL);
+        success = success && polled.result_item && strcmp(polled.result_item, "polled_item") == 0;
+        free(polled.result_item);
+
+        printf("  Testing an item put after the poll budget ran out...\n");
+        consumer_producer_set_spin(&queue, 1000000u);  // 1ms
+        blocking_test_data_t parked = {&queue, 0, NULL};
+        pthread_create(&consumer_thread, NULL, blocking_consumer_thread, &parked);
+        usleep(50000);  // 50ms
+        success = success && !parked.operation_completed;
+        consumer_producer_put(&queue, "parked_item");
+        pthread_join(consumer_thread, NULL);
+        success = success && parked.result_item && strcmp(parked.result_item, "parked_item") == 0;
+        free(parked.result_item);
+
+        printf("  Testing finish ends a polling consumer...\n");
+        consumer_producer_set_spin(&queue, 500000000u);
+        blocking_test_data_t finish = {&queue, 0, NULL};
+        pthread_create(&consumer_thread, NULL, blocking_consumer_thread, &finish);
+        usleep(20000);
+        consumer_producer_signal_finished(&queue);
+        pthread_join(consumer_thread, NULL);
+        success = success && finish.operation_completed && finish.result_item == NULL;
+
+        consumer_producer_destroy(&queue);
+    }
+
+    print_test_result("Busy-Poll Consumer", success);
+    return success;
+}
+
+// =============================================================================
+// LATENCY HISTOGRAM TESTS
+// =============================================================================
+
+// percentile within the bucket resolution of the exact answer
+static int close_enough(uint64_t got, uint64_t want) {
+    uint64_t slack = want / 16 + 1;
+    return got + slack >= want && got <= want + slack;
+}
+
+int test_lat_hist_percentiles() {
+    print_test_header("Latency Histogram Percentiles");
+
+    static lat_hist_t h;
+    lat_hist_init(&h);
+    int success = lat_hist_count(&h) == 0 && lat_hist_percentile(&h, 50.0) == 0;
+
+    // 1..100000 ns once each: the p-th percentile is p * 1000 ns
+    for (uint64_t v = 1; v <= 100000; v++) lat_hist_record(&h, v);
+    success = success && lat_hist_count(&h) == 100000;
+    success = success && close_enough(lat_hist_mean(&h), 50000);
+    success = success && close_enough(lat_hist_percentile(&h, 50.0), 50000);
+    success = success && close_enough(lat_hist_percentile(&h, 99.0), 99000);
+    success = success && close_enough(lat_hist_percentile(&h, 99.9), 99900);
+    success = success && close_enough(lat_hist_percentile(&h, 100.0), 100000);
+
+    // small values are exact, huge ones still land somewhere
+    lat_hist_init(&h);
+    for (int i = 0; i < 99; i++) lat_hist_record(&h, 7);
+    lat_hist_record(&h, UINT64_MAX);
+    success = success && lat_hist_percentile(&h, 50.0) == 7 && lat_hist_percentile(&h, 99.0) == 7;
+    success = success && lat_hist_percentile(&h, 100.0) == UINT64_MAX;
+
+    static lat_hist_t copy;
+    lat_hist_copy(&copy, &h);
+    success = success && lat_hist_count(&copy) == 100 && lat_hist_percentile(&copy, 50.0) == 7;
+
+    // merging adds the samples: 100 more at 7, then p50 and the max hold
+    lat_hist_merge(&copy, &h);
+    success = success && lat_hist_count(&copy) == 200 && lat_hist_percentile(&copy, 50.0) == 7;
+    success = success && lat_hist_percentile(&copy, 100.0) == UINT64_MAX;
+
+    print_test_result("Latency Histogram Percentiles", success);
+    return success;
+}
+
+// =============================================================================
+// MESSAGE POOL TESTS
+// =============================================================================
+
+#define POOL_TEST_ITEMS 20000
+
+// payload length for item i; every 1000th is above the largest pool class
+static size_t pool_test_len(int i) {
+    return (i % 1000 == 999) ? 100000 : (size_t)(i * 7 % 300);
+}
+
+// allocates pooled messages on its own thread; the main thread frees them
+void* pool_producer(void* arg) {
+    consumer_producer_t* queue = (consumer_producer_t*)arg;
+    for (int i = 0; i < POOL_TEST_ITEMS; i++) {
+        msg_t m;
+        size_t len = pool_test_len(i);
+        if (msg_alloc(&m, len) != 0) break;
+        memset(m.data, 'a' + i % 26, len);
+        if (consumer_producer_put_msg(queue, &m) != 0) {
+            msg_release(&m);
+            break;
+        }
+    }
+    msg_pool_thread_flush();
+    return NULL;
+}
+
+int test_msg_pool_cross_thread() {
+    print_test_header("Message Pool Across Threads");
+    
+    msg_pool_t* pool = msg_pool_create();
+    consumer_producer_t queue;
+    if (!pool || consumer_producer_init_backend(&queue, 16, CP_BACKEND_SPSC) != 0) {
+        print_test_result("Pool Setup", 0);
+        msg_pool_destroy(pool);
+        return 0;
+    }
+    msg_use_pool(pool);
+    
+    printf("  Allocating on one thread, freeing on another...\n");
+    pthread_t producer;
+    pthread_create(&producer, NULL, pool_producer, &queue);
+    
+    int success = 1;
+    for (int i = 0; i < POOL_TEST_ITEMS && success; i++) {
+        msg_t got;
+        size_t len = pool_test_len(i);
+        if (consumer_producer_get_msg(&queue, &got) != 0 || got.len != len) {
+            success = 0;
+            break;
+        }
+        // lines above the largest class fall back to malloc
+        int pooled = (got.flags & MSG_F_POOLED) != 0;
+        if (pooled != (len < 100000) || got.cap < len + 1 || got.data[len] != '\0') success = 0;
+        for (size_t k = 0; k < len && success; k++) {
+            if (got.data[k] != 'a' + i % 26) success = 0;
+        }
+        msg_release(&got);
+    }
+    pthread_join(producer, NULL);
+    
+    printf("  Testing blocks are reused instead of growing the pool...\n");
+    // in flight at once: the queue plus one cache per thread and class
+    if (pool->n_chunks > 64) {
+        printf("    Pool grew to %zu slabs\n", pool->n_chunks);
+        success = 0;
+    }
+    
+    printf("  Testing string shims copy pool blocks out...\n");
+    consumer_producer_put(&queue, "pooled");
+    char* str = consumer_producer_get(&queue);
+    success = success && str && strcmp(str, "pooled") == 0;
+    free(str);
+    
+    consumer_producer_destroy(&queue);
+    msg_pool_thread_flush();
+    msg_use_pool(NULL);
+    msg_pool_destroy(pool);
+    print_test_result("Message Pool Across Threads", success);
+    return success;
+}
+
+#define SHARE_BRANCHES 3
+#define SHARE_ITEMS    20000
+
+typedef struct {
+    consumer_producer_t queue;
+    const char* expect_data[SHARE_ITEMS];    // payload each item must point at
+    int ok;
+} share_branch_t;
+
+// checks every item is the broadcast payload itself, then lets go of it
+void* share_consumer(void* arg) {
+    share_branch_t* b = (share_branch_t*)arg;
+    b->ok = 1;
+    for (int i = 0; i < SHARE_ITEMS; i++) {
+        msg_t got;
+        if (consumer_producer_get_msg(&b->queue, &got) != 0) {
+            b->ok = 0;
+            break;
+        }
+        if (got.data != b->expect_data[i] || !(got.flags & MSG_F_SHARED) ||
+            got.len != 64 || got.data[0] != 'a' + i % 26 || got.data[63] != 'a' + i % 26) {
+            b->ok = 0;
+        }
+        msg_release(&got);
+    }
+    msg_pool_thread_flush();
+    return NULL;
+}
+
+int test_shared_messages() {
+    print_test_header("Shared Messages");
+
+    msg_pool_t* pool = msg_pool_create();
+    msg_use_pool(pool);
+    int success = pool != NULL;
+
+    printf("  Testing the last holder writes without a copy...\n");
+    msg_t a, b;
+    msg_from_cstr(&a, "payload");
+    char* orig = a.data;
+    success = success && msg_writable(&a) && msg_share(&b, &a) == 0;
+    success = success && b.data == orig && !msg_writable(&a) && !msg_writable(&b);
+    msg_release(&a);
+    success = success && msg_writable(&b) && msg_own(&b) == 0 && b.data == orig &&
+              !(b.flags & MSG_F_SHARED);
+    msg_release(&b);
+
+    printf("  Testing a holder that writes gets its own copy...\n");
+    msg_t c, d;
+    msg_end(&c);
+    success = success && msg_share(&d, &c) == 0 && msg_own(&d) == 0;
+    success = success && d.data != c.data && msg_is_end(&d) && msg_is_end(&c) &&
+              msg_writable(&c) && msg_writable(&d);
+    d.data[0] = 'x';
+    success = success && c.data[0] == '<';
+    msg_release(&c);
+    msg_release(&d);
+
+    printf("  Broadcasting to %d threads that release concurrently...\n", SHARE_BRANCHES);
+    static share_branch_t branches[SHARE_BRANCHES];
+    pthread_t tids[SHARE_BRANCHES];
+    for (int k = 0; k < SHARE_BRANCHES; k++) {
+        consumer_producer_init_backend(&branches[k].queue, 16, CP_BACKEND_SPSC);
+        pthread_create(&tids[k], NULL, share_consumer, &branches[k]);
+    }
+    for (int i = 0; i < SHARE_ITEMS; i++) {
+        msg_t m;
+        msg_alloc(&m, 64);
+        memset(m.data, 'a' + i % 26, 64);
+        for (int k = 0; k < SHARE_BRANCHES; k++) branches[k].expect_data[i] = m.data;
+        // as the graph tee does: a share per branch, the original to the last
+        for (int k = 0; k + 1 < SHARE_BRANCHES; k++) {
+            msg_t s;
+            msg_share(&s, &m);
+            consumer_producer_put_msg(&branches[k].queue, &s);
+        }
+        consumer_producer_put_msg(&branches[SHARE_BRANCHES - 1].queue, &m);
+    }
+    for (int k = 0; k < SHARE_BRANCHES; k++) {
+        pthread_join(tids[k], NULL);
+        success = success && branches[k].ok;
+        consumer_producer_destroy(&branches[k].queue);
+    }
+
+    printf("  Testing payloads and counts went back to the pool...\n");
+    // a leak or double free over 20000 broadcasts would grow or corrupt it
+    success = success && pool->n_chunks <= 64;
+
+    msg_pool_thread_flush();
+    msg_use_pool(NULL);
+    msg_pool_destroy(pool);
+    print_test_result("Shared Messages", success);
+    return success;
+}
+
 // =============================================================================
 // MAIN TEST RUNNER
 // =============================================================================
@@ -960,6 +1773,9 @@ int main() {
     test_init_destroy();
     test_single_producer_consumer();
     test_queue_capacity_limits();
+    test_put_owned_no_copy();
+    test_batch_put_get();
+    test_message_roundtrip();
     
     printf("\n🔧 EDGE CASE TESTS\n");
     printf("─────────────────────────────────────────────────────────────────\n");
@@ -980,6 +1796,35 @@ int main() {
     printf("─────────────────────────────────────────────────────────────────\n");
     test_concurrent_producers_consumers();
     
+    printf("\n🔧 SPSC BACKEND TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_spsc_wrapping_and_capacity();
+    test_spsc_blocking_consumer();
+    test_spsc_stress_ordering();
+    
+    printf("\n🔧 QUEUE STATS TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_queue_stats();
+
+    printf("\n🔧 MONITOR TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_monitor_eventcount();
+    test_busy_poll_consumer();
+
+    printf("\n🔧 OVERFLOW POLICY TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_overflow_policies();
+    test_timed_operations();
+
+    printf("\n🔧 LATENCY HISTOGRAM TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_lat_hist_percentiles();
+
+    printf("\n🔧 MESSAGE POOL TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_msg_pool_cross_thread();
+    test_shared_messages();
+    
     printf("\n🔧 STRESS TESTS\n");
     printf("─────────────────────────────────────────────────────────────────\n");
     test_stress_high_frequency();
@@ -1008,6 +1853,9 @@ int main() {
 //gcc tests/consumer_producer_test.c \
     plugins/sync/consumer_producer.c \
     plugins/sync/monitor.c \
+    plugins/sync/message.c \
+    plugins/sync/msg_pool.c \
+    plugins/sync/lat_hist.c \
     -Iplugins/sync \
     -lpthread \
     -o tests/test_runner
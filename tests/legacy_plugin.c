@@ -0,0 +1,95 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a plugin built against the original string SDK and nothing else: one
+// implicit instance, plugin_init/place_work/attach/wait_finished/fini and
+// no plugin_instance_* symbols. it reverses each line, like flipper, so
+// test.sh can load it next to the current plugins and compare.
+//gcc -shared -fPIC -O2 tests/legacy_plugin.c -lpthread -o output/legacy.so
+
+#define LEGACY_MAX_QUEUE 1024
+
+static struct {
+    char* items[LEGACY_MAX_QUEUE];
+    int head, count, cap;
+    int finished;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t worker;
+    const char* (*next)(const char*);
+} g_q = { .lock = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER };
+
+static char* take(void) {
+    pthread_mutex_lock(&g_q.lock);
+    while (g_q.count == 0) pthread_cond_wait(&g_q.changed, &g_q.lock);
+    char* s = g_q.items[g_q.head];
+    g_q.head = (g_q.head + 1) % g_q.cap;
+    g_q.count--;
+    pthread_cond_broadcast(&g_q.changed);
+    pthread_mutex_unlock(&g_q.lock);
+    return s;
+}
+
+static void* worker(void* arg) {
+    (void)arg;
+    for (;;) {
+        char* in = take();
+        if (strcmp(in, "<END>") == 0) {
+            free(in);
+            break;
+        }
+        size_t len = strlen(in);
+        for (size_t i = 0; i < len / 2; ++i) {
+            char c = in[i];
+            in[i] = in[len - 1 - i];
+            in[len - 1 - i] = c;
+        }
+        if (g_q.next) (void)g_q.next(in);
+        free(in);
+    }
+    if (g_q.next) (void)g_q.next("<END>");
+    pthread_mutex_lock(&g_q.lock);
+    g_q.finished = 1;
+    pthread_cond_broadcast(&g_q.changed);
+    pthread_mutex_unlock(&g_q.lock);
+    return NULL;
+}
+
+const char* plugin_get_name(void) {
+    return "legacy";
+}
+
+const char* plugin_init(int queue_size) {
+    if (queue_size <= 0 || queue_size > LEGACY_MAX_QUEUE) return "invalid queue size";
+    g_q.cap = queue_size;
+    if (pthread_create(&g_q.worker, NULL, worker, NULL) != 0) return "thread create failed";
+    return NULL;
+}
+
+const char* plugin_place_work(const char* str) {
+    char* s = str ? strdup(str) : NULL;
+    if (!s) return "enqueue failed";
+    pthread_mutex_lock(&g_q.lock);
+    while (g_q.count == g_q.cap) pthread_cond_wait(&g_q.changed, &g_q.lock);
+    g_q.items[(g_q.head + g_q.count) % g_q.cap] = s;
+    g_q.count++;
+    pthread_cond_broadcast(&g_q.changed);
+    pthread_mutex_unlock(&g_q.lock);
+    return NULL;
+}
+
+void plugin_attach(const char* (*next_place_work)(const char*)) {
+    g_q.next = next_place_work;
+}
+
+const char* plugin_wait_finished(void) {
+    pthread_mutex_lock(&g_q.lock);
+    while (!g_q.finished) pthread_cond_wait(&g_q.changed, &g_q.lock);
+    pthread_mutex_unlock(&g_q.lock);
+    return pthread_join(g_q.worker, NULL) == 0 ? NULL : "join failed";
+}
+
+const char* plugin_fini(void) {
+    return NULL;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../plugins/kernels/text_kernels.h"
+
+// Test configuration
+#define MAX_TEST_LEN 300        // every length up to this one is checked
+#define RANDOM_ROUNDS 50        // random buffers per length
+
+// Test results tracking
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_results_t;
+
+// Global test results
+test_results_t g_results = {0, 0, 0};
+
+// Helper functions
+void print_test_header(const char* test_name) {
+    printf("\n=== %s ===\n", test_name);
+}
+
+void print_test_result(const char* test_name, int passed) {
+    g_results.total_tests++;
+    if (passed) {
+        g_results.passed_tests++;
+        printf("✅ %s: PASSED\n", test_name);
+    } else {
+        g_results.failed_tests++;
+        printf("❌ %s: FAILED\n", test_name);
+    }
+}
+
+// any byte value, with letters and spaces more likely so case and spacing
+// paths are hit often
+void fill_random(char* buf, size_t n, unsigned* seed) {
+    for (size_t i = 0; i < n; ++i) {
+        *seed = *seed * 1103515245u + 12345u;
+        unsigned r = *seed >> 16;
+        switch (r % 4) {
+            case 0:  buf[i] = (char)('a' + r / 4 % 26); break;
+            case 1:  buf[i] = (char)('A' + r / 4 % 26); break;
+            case 2:  buf[i] = ' '; break;
+            default: buf[i] = (char)(r / 4); break;
+        }
+    }
+}
+
+// kernels must not write past what they were asked for
+int guard_intact(const char* buf, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        if (buf[i] != '#') return 0;
+    }
+    return 1;
+}
+
+// =============================================================================
+// EQUIVALENCE TESTS
+// =============================================================================
+
+int test_upper_matches_scalar() {
+    print_test_header("Uppercase Kernel Matches toupper()");
+
+    int success = 1;
+    unsigned seed = 1;
+    char src[MAX_TEST_LEN], ref[MAX_TEST_LEN], out[MAX_TEST_LEN + 64];
+    for (size_t len = 0; len <= MAX_TEST_LEN && success; ++len) {
+        for (int r = 0; r < RANDOM_ROUNDS && success; ++r) {
+            fill_random(src, len, &seed);
+            text_upper_scalar(ref, src, len);
+
+            memset(out, '#', sizeof(out));
+            text_upper(out, src, len);
+            success = memcmp(out, ref, len) == 0 && guard_intact(out, len, sizeof(out));
+
+            // in place, as the uppercaser's in-place export uses it
+            memcpy(out, src, len);
+            text_upper(out, out, len);
+            success = success && memcmp(out, ref, len) == 0;
+            if (!success) printf("    Mismatch at length %zu\n", len);
+        }
+    }
+
+    print_test_result("Uppercase Kernel Matches toupper()", success);
+    return success;
+}
+
+int test_reverse_matches_scalar() {
+    print_test_header("Reverse Kernels Match Byte Loop");
+
+    int success = 1;
+    unsigned seed = 2;
+    char src[MAX_TEST_LEN], ref[MAX_TEST_LEN], out[MAX_TEST_LEN + 64];
+    for (size_t len = 0; len <= MAX_TEST_LEN && success; ++len) {
+        for (int r = 0; r < RANDOM_ROUNDS && success; ++r) {
+            fill_random(src, len, &seed);
+            text_reverse_scalar(ref, src, len);
+
+            memset(out, '#', sizeof(out));
+            text_reverse(out, src, len);
+            success = memcmp(out, ref, len) == 0 && guard_intact(out, len, sizeof(out));
+
+            memset(out, '#', sizeof(out));
+            memcpy(out, src, len);
+            text_reverse_inplace(out, len);
+            success = success && memcmp(out, ref, len) == 0 && guard_intact(out, len, sizeof(out));
+            if (!success) printf("    Mismatch at length %zu\n", len);
+        }
+    }
+
+    print_test_result("Reverse Kernels Match Byte Loop", success);
+    return success;
+}
+
+int test_interleave_matches_scalar() {
+    print_test_header("Interleave Kernel Matches Byte Loop");
+
+    int success = 1;
+    unsigned seed = 3;
+    char src[MAX_TEST_LEN], ref[2 * MAX_TEST_LEN], out[2 * MAX_TEST_LEN + 64];
+    for (size_t len = 0; len <= MAX_TEST_LEN && success; ++len) {
+        size_t out_len = len ? 2 * len - 1 : 0;
+        for (int r = 0; r < RANDOM_ROUNDS && success; ++r) {
+            fill_random(src, len, &seed);
+            text_interleave_spaces_scalar(ref, src, len);
+
+            memset(out, '#', sizeof(out));
+            text_interleave_spaces(out, src, len);
+            success = memcmp(out, ref, out_len) == 0 && guard_intact(out, out_len, sizeof(out));
+            if (!success) printf("    Mismatch at length %zu\n", len);
+        }
+    }
+
+    print_test_result("Interleave Kernel Matches Byte Loop", success);
+    return success;
+}
+
+int test_known_outputs() {
+    print_test_header("Kernels On Known Lines");
+
+    // the lines the plugin tests use, plus one long enough for every vector path
+    const char* line = "Hello, World! the quick brown fox jumps over the lazy dog 0123456789";
+    size_t len = strlen(line);
+    char out[256];
+    int success = 1;
+
+    text_upper(out, line, len);
+    out[len] = '\0';
+    success = success && strcmp(out, "HELLO, WORLD! THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789") == 0;
+
+    text_reverse(out, line, len);
+    out[len] = '\0';
+    success = success && strcmp(out, "9876543210 god yzal eht revo spmuj xof nworb kciuq eht !dlroW ,olleH") == 0;
+
+    text_interleave_spaces(out, "ABC", 3);
+    out[5] = '\0';
+    success = success && strcmp(out, "A B C") == 0;
+
+    print_test_result("Kernels On Known Lines", success);
+    return success;
+}
+
+int main() {
+    printf("=================================================================\n");
+    printf("               TEXT KERNEL EQUIVALENCE TEST SUITE                \n");
+    printf("=================================================================\n");
+
+    printf("\n🔧 EQUIVALENCE TESTS\n");
+    printf("─────────────────────────────────────────────────────────────────\n");
+    test_upper_matches_scalar();
+    test_reverse_matches_scalar();
+    test_interleave_matches_scalar();
+    test_known_outputs();
+
+    // Final summary
+    printf("\n=================================================================\n");
+    printf("                           TEST SUMMARY                          \n");
+    printf("=================================================================\n");
+    printf("Total Tests:  %d\n", g_results.total_tests);
+    printf("Passed:       %d ✅\n", g_results.passed_tests);
+    printf("Failed:       %d ❌\n", g_results.failed_tests);
+
+    return g_results.failed_tests == 0 ? 0 : 1;
+}
+
+
+
+//gcc tests/text_kernels_test.c \
+    plugins/kernels/text_kernels.c \
+    -o tests/text_kernels_test
+
+//./tests/text_kernels_test